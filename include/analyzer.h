@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "chip8.h"
+
+#define MAX_REGIONS 256
+
+// cache format & heuristics version, bump it when either changes
+#define ANALYSIS_VERSION 2
+
+typedef struct Region {
+    unsigned short start;
+    unsigned short end;         // inclusive
+    bool code;
+} Region;
+
+// static analysis of a rom, cached on disk by rom hash
+typedef struct Analysis {
+    unsigned long long rom_hash;
+
+    // reachable opcodes whose behavior depends on a quirk
+    int shift_xy;               // 8XY6 / 8XYE with X != Y
+    int jump_offset;            // BNNN with NNN's high nibble != 0
+    int store_load;             // FX55 / FX65
+
+    // evidence for each setting (votes from the code around those opcodes)
+    int shift_vy_votes, shift_vx_votes;
+    int jump_vx_votes, jump_v0_votes;
+    int inc_votes, no_inc_votes;
+
+    // recommended profile
+    bool shift_use_vy;
+    bool jump_offset_vx;
+    bool store_load_i_inc;
+
+    // code & data regions of the rom
+    int region_count;
+    Region regions[MAX_REGIONS];
+} Analysis;
+
+unsigned long long rom_hash(const unsigned _BitInt(8)*, int);
+void analyze_rom(const unsigned _BitInt(8)*, int, Analysis*);
+void apply_analysis(Chip8*, const Analysis*);
+void disassemble(unsigned _BitInt(16), char*, size_t);
+
+// persistent cache ($XDG_CACHE_HOME/chip8emu or ~/.cache/chip8emu)
+bool analysis_cache_load(unsigned long long, Analysis*);
+bool analysis_cache_store(const Analysis*);
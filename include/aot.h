@@ -0,0 +1,30 @@
+#pragma once
+
+#include "chip8.h"
+
+// basic block compiled ahead of time by chip8aot
+typedef struct AotBlock {
+    unsigned short start;       // address of the first instruction
+    unsigned short len;         // number of instructions
+    int (*run)(Chip8*);         // returns instructions executed (== len)
+} AotBlock;
+
+// generated translation unit exports one of these as `aot_program`
+typedef struct AotProgram {
+    const unsigned char *image; // rom bytes the blocks were compiled from (at 0x200)
+    int image_len;
+    const AotBlock *blocks;
+    int block_count;
+} AotProgram;
+
+// lookup by program counter, plus how instructions were executed
+typedef struct AotTable {
+    const AotProgram *prog;
+    const AotBlock *at[4096];
+    unsigned long compiled;
+    unsigned long interpreted;
+} AotTable;
+
+void aot_load(const AotProgram*, AotTable*);
+int  aot_run(Chip8*, AotTable*, int);
+void aot_run_frame(Chip8*, AotTable*);
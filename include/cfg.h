@@ -0,0 +1,18 @@
+#pragma once
+
+#include "chip8.h"
+
+// static control-flow graph of a rom, walked from 0x200
+typedef struct Cfg {
+    int rom_end;            // first address past the loaded rom
+    bool code[4096];        // a reachable instruction starts here
+    bool leader[4096];      // first instruction of a basic block
+    bool block_end[4096];   // instruction transfers control (jump, call, skip, ...)
+                            // or stores where I isn't known statically
+    bool dynamic[4096];     // successor not known statically (BNNN, 00EE, leaves rom)
+    bool written[4096];     // statically known FX55 / FX33 store target
+} Cfg;
+
+void build_cfg(const unsigned _BitInt(8)*, int, Cfg*);
+bool ends_block(unsigned _BitInt(16));
+int  successors(unsigned _BitInt(16), int, int*);
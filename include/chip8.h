@@ -1,5 +1,15 @@
 #pragma once
 
+// fused instruction idioms (see execute_fused)
+enum {
+    FUSE_SET_DELAY,     // 6XNN + FX15
+    FUSE_DRAW_CONST,    // ANNN + DXYN
+    FUSE_ADD_CHAIN,     // 7XNN + 7XNN ...
+    FUSE_DELAY_WAIT,    // FX07 + 3X00 + 1NNN (back to the FX07)
+    FUSE_BCD_LOAD,      // FX33 + FX65
+    FUSE_COUNT
+};
+
 typedef struct Chip8 {
     // display
     unsigned _BitInt(64) display[32];
@@ -13,6 +23,13 @@ typedef struct Chip8 {
     // timers
     unsigned _BitInt(8) delay_timer;
     unsigned _BitInt(8) sound_timer;
+    unsigned long frame_count;
+
+    // keypad, one bit per key 0-F
+    unsigned _BitInt(16) keys;
+
+    // random number generator state (CXNN), part of the snapshot
+    unsigned _BitInt(32) rng_state;
 
     // stack
     unsigned _BitInt(16) stack[16];
@@ -23,4 +40,18 @@ typedef struct Chip8 {
     bool shift_use_vy;
     bool jump_offset_vx;
     bool store_load_i_inc;
+    bool fuse_ops;
+    bool hash_state;
+
+    // macro-op fusion stats - times each idiom fused, instructions retired by fused ops
+    unsigned long fused[FUSE_COUNT];
+    unsigned long fused_retired;
+
+    // zobrist hash of the tracked state (state_hash.h), kept while hash_state is set
+    unsigned long long state_hash;
+
+    // debugger (NULL unless attached)
+    // debug_armed is only set while a breakpoint, watchpoint or step is pending
+    struct Debugger *debugger;
+    bool debug_armed;
 } Chip8 ;
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "chip8.h"
+
+// instruction decode macros
+#define OP(ins) ((ins & 0xF000) >> 12)
+#define X(ins) ((ins & 0x0F00) >> 8)
+#define Y(ins) ((ins & 0x00F0) >> 4)
+#define N(ins) (ins & 0x000F)
+#define NN(ins) (ins & 0x00FF)
+#define NNN(ins) (ins & 0x0FFF)
+
+// faults returned by execute_instruction / execute_opcode
+// the faulting instruction has no effect other than moving the program counter past it
+enum {
+    FAULT_NONE,
+    FAULT_STACK_OVERFLOW,   // 2NNN with 16 return addresses on the stack
+    FAULT_STACK_UNDERFLOW,  // 00EE with an empty stack
+    FAULT_BAD_OPCODE,       // 0NNN machine code call or an undefined opcode
+    FAULT_MEM_BOUNDS,       // fetch, DXYN, FX33, FX55 or FX65 past 0xFFF
+    FAULT_COUNT
+};
+
+// fetch, decode & execute a single instruction
+int  execute_instruction(Chip8*);
+int  execute_opcode(Chip8*, unsigned _BitInt(16));
+int  execute_fused(Chip8*, int);
+
+// 60hz frame
+int  frame_instructions(Chip8*);
+void tick_timers(Chip8*);
+void run_frame(Chip8*);
+unsigned long long display_hash(Chip8*);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "chip8.h"
+
+// conditional breakpoint comparison
+typedef enum DebugCmp {
+    CMP_NONE,
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_GT
+} DebugCmp;
+
+typedef struct DebugCond {
+    DebugCmp cmp;
+    unsigned _BitInt(4) reg;
+    unsigned _BitInt(8) val;
+} DebugCond;
+
+typedef struct Debugger {
+    // 4096-bit bitmaps, one bit per address
+    unsigned _BitInt(64) breakpoints[64];
+    unsigned _BitInt(64) watchpoints[64];
+    int bp_count;
+    int wp_count;
+
+    // display row watchpoints (draw / clear), one bit per row
+    unsigned _BitInt(32) watch_rows;
+
+    // optional register condition per breakpoint address
+    DebugCond conds[4096];
+
+    // pending stop reasons
+    bool stepping;
+    bool watch_hit;
+    unsigned _BitInt(16) watch_addr;
+    unsigned _BitInt(12) watch_pc;
+    char stop_reason[64];       // printed by debugger_prompt once the display is suspended
+
+    // command interface
+    int listen_fd;
+    char path[108];             // socket path, unlinked on detach
+    int in_fd;
+    int out_fd;
+    char buf[256];
+    int buf_len;
+    char line[256];
+} Debugger;
+
+// attach / detach
+int  debugger_attach(Chip8*, const char*);
+void debugger_detach(Chip8*);
+
+// dispatcher hooks (only called while emu->debug_armed is set)
+bool debugger_check(Chip8*);
+void debugger_watch_mem(Chip8*, unsigned _BitInt(16));
+void debugger_watch_row(Chip8*, int);
+
+// command interface
+int  debugger_prompt(Chip8*);
+int  debugger_poll(Chip8*);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "chip8.h"
+
+#define FUZZ_FRAMES  30         // frames run per execution (one input segment)
+#define FUZZ_CORPUS  8192       // max saved states
+#define FUZZ_MAP     4096       // pc / edge coverage bitmap entries
+#define FUZZ_CRASHES 256        // max distinct faults (fault, pc) kept
+
+// saved state, the state after running one input segment from its parent
+// entry 0 is the power-on state
+typedef struct FuzzEntry {
+    int parent;
+    unsigned _BitInt(32) seed;                  // rng_state at the start of the segment
+    unsigned _BitInt(16) keys[FUZZ_FRAMES];     // keypad per frame
+    Chip8 state;
+} FuzzEntry;
+
+// distinct fault, with the segment that first hit it
+typedef struct FuzzCrash {
+    int fault;                                  // FAULT_* (cpu.h)
+    int pc;                                     // address of the faulting instruction
+    int parent;
+    unsigned _BitInt(32) seed;
+    unsigned _BitInt(16) keys[FUZZ_FRAMES];
+} FuzzCrash;
+
+struct Fuzzer;
+
+typedef struct FuzzWorker {
+    struct Fuzzer *fuzz;
+    pthread_t thread;
+    unsigned _BitInt(32) rng;
+    atomic_ulong execs;
+} FuzzWorker;
+
+typedef struct Fuzzer {
+    FuzzWorker *workers;
+    int worker_count;
+    atomic_bool stopping;
+
+    // corpus, entries are only appended (under lock) and never change after
+    FuzzEntry *corpus;
+    atomic_int corpus_count;
+
+    // global coverage & faults
+    pthread_mutex_t lock;
+    unsigned char pc_map[FUZZ_MAP];
+    unsigned char edge_map[FUZZ_MAP];
+    atomic_int pcs_covered;
+    atomic_int edges_covered;
+    FuzzCrash crashes[FUZZ_CRASHES];
+    atomic_int crash_count;
+    atomic_ulong faults;                        // executions that ended in a fault
+} Fuzzer;
+
+Fuzzer* fuzzer_new(Chip8 *initial, int workers, unsigned _BitInt(32) seed);
+void    fuzzer_stop(Fuzzer*);
+void    fuzzer_free(Fuzzer*);
+unsigned long fuzzer_execs(Fuzzer*);
+
+// reproducers - every segment from power-on up to the fault
+const char* fault_name(int fault);
+void    fuzzer_write_repro(Fuzzer*, const FuzzCrash*, FILE*);
+int     fuzzer_replay(Chip8*, FILE*, int *pc);
@@ -5,8 +5,15 @@
 // chip 8 initialization
 struct Chip8* new_chip8(int);
 
+// chip 8 snapshot
+void snapshot_chip8(Chip8 *emu, Chip8 *snap);
+void restore_chip8(Chip8 *emu, Chip8 *snap);
+
 // chip 8 configuration
 void config_timing(Chip8 *emu, int val);
 void config_shift(struct Chip8 *emu, bool val);
 void config_jump_offset(struct Chip8 *emu, bool val);
-void config_store_load_inc(struct Chip8 *emu, bool val);
\ No newline at end of file
+void config_store_load_inc(struct Chip8 *emu, bool val);
+void config_quirk_analysis(struct Chip8 *emu, int rom_len);
+void config_fusion(struct Chip8 *emu, bool val);
+void config_state_hash(struct Chip8 *emu, bool val);
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 // display
 void disp_clear(Chip8*);
-void draw(Chip8*, unsigned _BitInt(4), unsigned _BitInt(4), unsigned _BitInt(4));
+int  draw(Chip8*, unsigned _BitInt(4), unsigned _BitInt(4), unsigned _BitInt(4));
 
 // flow
 void jump(Chip8*, unsigned _BitInt(12));
@@ -41,16 +41,16 @@ void subtract_y_x(Chip8*, unsigned _BitInt(4), unsigned _BitInt(4));
 void set_index(Chip8*, unsigned _BitInt(12));
 void add_index(Chip8*, unsigned _BitInt(4));
 void sprite_index(Chip8*, unsigned _BitInt(4));
-void reg_dump(Chip8*, unsigned _BitInt(4));
-void reg_load(Chip8*, unsigned _BitInt(4));
+int  reg_dump(Chip8*, unsigned _BitInt(4));
+int  reg_load(Chip8*, unsigned _BitInt(4));
 
 // rand
 void gen_rand(Chip8*, unsigned _BitInt(4), unsigned _BitInt(8));
 
 // keyop
-// -
-// -
-// -
+void skip_key_pressed(Chip8*, unsigned _BitInt(4));
+void skip_key_not_pressed(Chip8*, unsigned _BitInt(4));
+void await_key(Chip8*, unsigned _BitInt(4));
 
 // timer
 void delay_timer(Chip8*, unsigned _BitInt(4));
@@ -60,4 +60,4 @@ void get_delay(Chip8*, unsigned _BitInt(4));
 void sound_timer(Chip8*, unsigned _BitInt(4));
 
 // bcd
-void bcd(Chip8*, unsigned _BitInt(4));
+int  bcd(Chip8*, unsigned _BitInt(4));
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "chip8.h"
+
+// timer wheel - 1ms slots, 64ms horizon (more than one 60hz frame)
+#define WHEEL_SLOTS   64
+#define WHEEL_SLOT_NS 1000000
+#define FRAME_NS      (1000000000 / 60)
+
+// lateness histogram - 100us buckets, last bucket catches everything above 20ms
+#define LATE_BUCKET_NS 100000
+#define LATE_BUCKETS   201
+
+struct SchedWorker;
+
+typedef struct SchedInstance {
+    Chip8 *emu;
+    struct SchedWorker *worker;
+    long long deadline;             // next frame start, CLOCK_MONOTONIC ns (offset while in the inbox)
+    struct SchedInstance *next;     // wheel slot / inbox list
+
+    // handed over under the worker's lock
+    unsigned _BitInt(16) keys;      // keypad for the next frame
+    struct SchedInstance *next_input;
+    bool input_pending;
+    bool removing;                  // scheduler_remove asked the worker to let go
+    bool removed;                   // worker no longer touches it
+} SchedInstance;
+
+struct Scheduler;
+
+typedef struct SchedWorker {
+    struct Scheduler *sched;
+    pthread_t thread;
+
+    // owned by the worker thread
+    SchedInstance *wheel[WHEEL_SLOTS];
+    long long wheel_time;           // start of the next slot to run
+
+    // instances, input & removals handed over by other threads
+    // wake - signalled on a new instance, a removal or stop
+    // done - signalled once removed instances are out of the wheel
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    SchedInstance *inbox;
+    SchedInstance *inputs;
+    int removals;
+    atomic_int count;
+
+    // stats
+    unsigned long frames;
+    unsigned long dropped;          // frames skipped after falling a whole frame behind
+    unsigned long late[LATE_BUCKETS];
+} SchedWorker;
+
+typedef struct Scheduler {
+    SchedWorker *workers;
+    int worker_count;
+    atomic_bool stopping;
+    atomic_ulong added;
+} Scheduler;
+
+Scheduler*     scheduler_new(int workers);
+SchedInstance* scheduler_add(Scheduler*, Chip8*);
+void           scheduler_remove(Scheduler*, SchedInstance*);
+void           scheduler_set_keys(Scheduler*, SchedInstance*, unsigned _BitInt(16));
+void           scheduler_stop(Scheduler*);
+void           scheduler_free(Scheduler*);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include "chip8.h"
+
+// layout of the shared memory segment
+// seqlock - the writer makes seq odd while updating and even when done,
+// readers retry until they copy a frame with the same even seq on both sides
+typedef struct ShmFrame {
+    _Atomic unsigned int seq;
+    unsigned long long display[32];
+    unsigned long long frame_count;
+    unsigned char delay_timer;
+    unsigned char sound_timer;
+} ShmFrame;
+
+// writer
+ShmFrame* shm_export_open(const char*);
+void      shm_export_publish(ShmFrame*, Chip8*);
+void      shm_export_close(ShmFrame*, const char*);
+
+// reader
+ShmFrame* shm_view_open(const char*);
+void      shm_view_read(ShmFrame*, Chip8*);
+void      shm_view_close(ShmFrame*);
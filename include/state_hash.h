@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "chip8.h"
+
+// zobrist slots - a state's hash is the xor of zkey(slot, value) over every slot
+// the handlers in instructions.c keep the tracked slots up to date in
+// emu->state_hash while hash_state is set, the slots that change every
+// instruction / frame are folded in when the hash is read
+enum {
+    HASH_MEM   = 0,         // memory[0x000 - 0xFFF]
+    HASH_V0    = 4096,      // V0 - VF
+    HASH_I     = 4112,
+    HASH_STACK = 4113,      // stack[0 - stack_top], slots above the top aren't hashed
+    HASH_SP    = 4129,
+    HASH_RNG   = 4130,
+    HASH_ROW   = 4131,      // display rows 0 - 31
+
+    // not tracked, read straight from the state
+    HASH_PC    = 4163,
+    HASH_DELAY = 4164,
+    HASH_SOUND = 4165,
+    HASH_FRAME = 4166       // frame_count % 60, sets the frame's instruction count
+};
+
+unsigned long long zkey(int slot, unsigned long long value);
+unsigned long long state_hash(Chip8*);
+unsigned long long state_hash_full(Chip8*);
+void               state_hash_reset(Chip8*);
+
+// visited set of state hashes, open addressing (8 bytes per slot, grows at 1/2 load)
+typedef struct StateSet {
+    unsigned long long *slots;  // 0 - empty
+    size_t capacity;            // power of two
+    size_t count;
+} StateSet;
+
+StateSet* state_set_new(size_t capacity);
+bool      state_set_insert(StateSet*, unsigned long long);
+void      state_set_free(StateSet*);
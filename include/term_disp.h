@@ -4,6 +4,11 @@
 
 void term_disp_init();
 void term_disp_end();
+void term_disp_suspend();
+void term_disp_resume();
 void term_disp_print(Chip8*, int*, int*);
+void term_disp_keys(Chip8*);
 void print_display_full(Chip8*);
-void print_display_half(Chip8*);
\ No newline at end of file
+void print_display_half(Chip8*);
+void print_display_braille(Chip8*);
+void print_braille(const unsigned _BitInt(64)*, int, int);
\ No newline at end of file
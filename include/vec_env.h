@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "chip8.h"
+
+// observation layout written by vec_env_step, per instance
+// OBS_PACKED - 256 bytes, 8 per row, most significant bit is the leftmost pixel
+// OBS_BYTES  - 2048 bytes, one 0/1 byte per pixel, row major
+typedef enum VecObs {
+    OBS_PACKED,
+    OBS_BYTES
+} VecObs;
+
+// per instance counters for the step just taken
+typedef struct VecInfo {
+    unsigned long frame_count;
+    int pixels_changed;     // display bits flipped this frame
+    bool sound_started;     // sound timer went from 0 to running (most games beep on score)
+    bool halted;            // program counter ran off the end of memory
+} VecInfo;
+
+struct VecEnv;
+
+// worker thread argument
+typedef struct VecShard {
+    struct VecEnv *venv;
+    int index;
+} VecShard;
+
+typedef struct VecEnv {
+    Chip8 *envs;            // count instances, contiguous
+    Chip8 initial;          // power-on state for vec_env_reset
+    int count;
+
+    // worker threads (the calling thread runs the first shard)
+    int threads;
+    pthread_t *workers;
+    VecShard *shards;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    bool stopping;
+
+    // arguments of the step in progress
+    const unsigned _BitInt(16) *keys;
+    unsigned char *obs;
+    VecObs format;
+    VecInfo *info;
+} VecEnv;
+
+VecEnv* vec_env_new(int rom_fd, int count, int threads);
+void    vec_env_free(VecEnv*);
+void    vec_env_seed(VecEnv*, unsigned long seed);
+void    vec_env_reset(VecEnv*, int index);
+size_t  vec_env_obs_size(VecObs format);
+void    vec_env_step(VecEnv*, const unsigned _BitInt(16) *keys, unsigned char *obs,
+                     VecObs format, VecInfo *info);
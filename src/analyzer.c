@@ -0,0 +1,353 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "analyzer.h"
+#include "cfg.h"
+#include "chip8.h"
+#include "cpu.h"
+#include "init.h"
+
+static int  reg_writes(unsigned _BitInt(16));
+static int  last_write(const unsigned _BitInt(8)*, const Cfg*, int, int);
+static void vote_store_load(const unsigned _BitInt(8)*, const Cfg*, int, Analysis*);
+static bool cache_path(unsigned long long, char*, size_t);
+
+#define FETCH(mem, addr) ((mem)[addr] * 0x100 + (mem)[(addr) + 1])
+
+////////////////////////////////////////////////////////////
+//                        Analysis                        //
+////////////////////////////////////////////////////////////
+
+// FNV-1a over the rom bytes
+unsigned long long rom_hash(const unsigned _BitInt(8) *memory, int rom_len) {
+    unsigned long long hash = 0xCBF29CE484222325;
+    for (int i=0; i<rom_len; i++) {
+        hash ^= memory[0x200 + i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+// find quirk dependent opcodes in reachable code, vote on each quirk from the
+// surrounding code & split the rom into code / data regions
+// memory  - 4096 bytes with the rom loaded at 0x200
+// rom_len - rom size in bytes
+void analyze_rom(const unsigned _BitInt(8) *memory, int rom_len, Analysis *an) {
+    Cfg *cfg = (Cfg*)malloc(sizeof(Cfg));
+    build_cfg(memory, rom_len, cfg);
+
+    memset(an, 0, sizeof(Analysis));
+    an->rom_hash = rom_hash(memory, rom_len);
+
+    for (int addr=0x200; addr<cfg->rom_end; addr++) {
+        if (!cfg->code[addr]) {
+            continue;
+        }
+        unsigned _BitInt(16) ins = FETCH(memory, addr);
+
+        // 8XY6 / 8XYE : shift VY into VX, or shift VX in place
+        // VY set up just before -> written for shift_use_vy
+        if (OP(ins) == 0x8 && (N(ins) == 0x6 || N(ins) == 0xE) && X(ins) != Y(ins)) {
+            an->shift_xy++;
+            int last = last_write(memory, cfg, addr, (1 << X(ins)) | (1 << Y(ins)));
+            if (last == Y(ins)) {
+                an->shift_vy_votes++;
+            } else if (last == X(ins)) {
+                an->shift_vx_votes++;
+            }
+        }
+
+        // BNNN : offset from V0 or from VX (X = high nibble of NNN)
+        if (OP(ins) == 0xB && X(ins) != 0) {
+            an->jump_offset++;
+            int last = last_write(memory, cfg, addr, (1 << X(ins)) | 1);
+            if (last == X(ins)) {
+                an->jump_vx_votes++;
+            } else if (last == 0) {
+                an->jump_v0_votes++;
+            }
+        }
+
+        // FX55 / FX65 : does the code after it expect I to have moved
+        if (OP(ins) == 0xF && (NN(ins) == 0x55 || NN(ins) == 0x65)) {
+            an->store_load++;
+            vote_store_load(memory, cfg, addr, an);
+        }
+    }
+
+    an->shift_use_vy = an->shift_vy_votes > an->shift_vx_votes;
+    an->jump_offset_vx = an->jump_vx_votes > an->jump_v0_votes;
+    an->store_load_i_inc = an->inc_votes > an->no_inc_votes;
+
+    // code / data regions, an instruction covers two bytes
+    for (int addr=0x200; addr<cfg->rom_end; addr++) {
+        bool code = cfg->code[addr] || cfg->code[addr - 1];
+        Region *last = an->region_count > 0 ? &an->regions[an->region_count - 1] : NULL;
+        if (last != NULL && last->code == code && last->end == addr - 1) {
+            last->end = addr;
+        }
+        else if (an->region_count < MAX_REGIONS) {
+            an->regions[an->region_count++] = (Region){ addr, addr, code };
+        }
+        else {
+            last->end = addr; // out of regions, fold into the last one
+        }
+    }
+
+    free(cfg);
+}
+
+// configure the emulator with the recommended profile
+void apply_analysis(Chip8 *emu, const Analysis *an) {
+    config_shift(emu, an->shift_use_vy);
+    config_jump_offset(emu, an->jump_offset_vx);
+    config_store_load_inc(emu, an->store_load_i_inc);
+}
+
+// registers written by an instruction (bit per register)
+static int reg_writes(unsigned _BitInt(16) ins) {
+    int x = 1 << X(ins);
+    switch (OP(ins)) {
+    case 0x6: case 0x7: case 0xC:
+        return x;
+    case 0x8:
+        if (N(ins) <= 0x3) {
+            return x;
+        }
+        if (N(ins) <= 0x7 || N(ins) == 0xE) {
+            return x | 0x8000; // VF flag
+        }
+        return 0;
+    case 0xD:
+        return 0x8000;
+    case 0xF:
+        if (NN(ins) == 0x07 || NN(ins) == 0x0A) {
+            return x;
+        }
+        if (NN(ins) == 0x65) {
+            return (x << 1) - 1; // V0 - VX
+        }
+        return 0;
+    }
+    return 0;
+}
+
+// walk back through the basic block before addr
+// return which register in mask was written most recently (-1 - none in the block)
+static int last_write(const unsigned _BitInt(8) *memory, const Cfg *cfg, int addr, int mask) {
+    for (int a=addr-2; a>=0x200 && cfg->code[a] && !cfg->block_end[a]; a-=2) {
+        int written = reg_writes(FETCH(memory, a)) & mask;
+        if (written) {
+            // prefer VX / VY over V0 / VF when one instruction writes both
+            for (int r=15; r>=0; r--) {
+                if ((written >> r) & 1) {
+                    return r;
+                }
+            }
+        }
+        if (cfg->leader[a]) {
+            break;
+        }
+    }
+    return -1;
+}
+
+// next use of I after FX55 / FX65 at addr, in the same block or around a loop
+// - FX1E steps I by hand                      -> no increment
+// - FX55 / FX65 / FX33 / DXYN reuse I as is   -> relies on increment
+// - ANNN / FX29 reload I                      -> no evidence
+static void vote_store_load(const unsigned _BitInt(8) *memory, const Cfg *cfg, int addr, Analysis *an) {
+    for (int a=addr+2; a+1<cfg->rom_end && cfg->code[a]; a+=2) {
+        unsigned _BitInt(16) ins = FETCH(memory, a);
+
+        if (OP(ins) == 0xA || (OP(ins) == 0xF && NN(ins) == 0x29)) {
+            return;
+        }
+        if (OP(ins) == 0xF && NN(ins) == 0x1E) {
+            an->no_inc_votes++;
+            return;
+        }
+        if (OP(ins) == 0xD || (OP(ins) == 0xF && (NN(ins) == 0x55 || NN(ins) == 0x65 || NN(ins) == 0x33))) {
+            an->inc_votes++;
+            return;
+        }
+
+        if (cfg->block_end[a]) {
+            // loop straight back over the store / load without reloading I
+            if (OP(ins) == 0x1 && NNN(ins) <= addr) {
+                for (int b=NNN(ins); b<addr; b+=2) {
+                    unsigned _BitInt(16) body = FETCH(memory, b);
+                    if (OP(body) == 0xA || (OP(body) == 0xF && (NN(body) == 0x29 || NN(body) == 0x1E))) {
+                        return;
+                    }
+                }
+                an->inc_votes++;
+            }
+            return;
+        }
+    }
+}
+
+// mnemonic for an instruction (Cowgod's syntax)
+void disassemble(unsigned _BitInt(16) ins, char *buf, size_t len) {
+    int x = X(ins), y = Y(ins), n = N(ins), nn = NN(ins), nnn = NNN(ins);
+
+    switch (OP(ins)) {
+    case 0x0:
+        if (nnn == 0x0E0)      snprintf(buf, len, "CLS");
+        else if (nnn == 0x0EE) snprintf(buf, len, "RET");
+        else                   snprintf(buf, len, "SYS  0x%03X", nnn);
+        return;
+    case 0x1: snprintf(buf, len, "JP   0x%03X", nnn); return;
+    case 0x2: snprintf(buf, len, "CALL 0x%03X", nnn); return;
+    case 0x3: snprintf(buf, len, "SE   V%X, 0x%02X", x, nn); return;
+    case 0x4: snprintf(buf, len, "SNE  V%X, 0x%02X", x, nn); return;
+    case 0x5:
+        if (n == 0) { snprintf(buf, len, "SE   V%X, V%X", x, y); return; }
+        break;
+    case 0x6: snprintf(buf, len, "LD   V%X, 0x%02X", x, nn); return;
+    case 0x7: snprintf(buf, len, "ADD  V%X, 0x%02X", x, nn); return;
+    case 0x8: {
+        static const char *ops[16] = {
+            "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+            NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL
+        };
+        if (ops[n] != NULL) {
+            snprintf(buf, len, "%-4s V%X, V%X", ops[n], x, y);
+            return;
+        }
+        break;
+    }
+    case 0x9:
+        if (n == 0) { snprintf(buf, len, "SNE  V%X, V%X", x, y); return; }
+        break;
+    case 0xA: snprintf(buf, len, "LD   I, 0x%03X", nnn); return;
+    case 0xB: snprintf(buf, len, "JP   V0, 0x%03X", nnn); return;
+    case 0xC: snprintf(buf, len, "RND  V%X, 0x%02X", x, nn); return;
+    case 0xD: snprintf(buf, len, "DRW  V%X, V%X, %d", x, y, n); return;
+    case 0xE:
+        if (nn == 0x9E) { snprintf(buf, len, "SKP  V%X", x); return; }
+        if (nn == 0xA1) { snprintf(buf, len, "SKNP V%X", x); return; }
+        break;
+    case 0xF:
+        switch (nn) {
+        case 0x07: snprintf(buf, len, "LD   V%X, DT", x); return;
+        case 0x0A: snprintf(buf, len, "LD   V%X, K", x); return;
+        case 0x15: snprintf(buf, len, "LD   DT, V%X", x); return;
+        case 0x18: snprintf(buf, len, "LD   ST, V%X", x); return;
+        case 0x1E: snprintf(buf, len, "ADD  I, V%X", x); return;
+        case 0x29: snprintf(buf, len, "LD   F, V%X", x); return;
+        case 0x33: snprintf(buf, len, "LD   B, V%X", x); return;
+        case 0x55: snprintf(buf, len, "LD   [I], V%X", x); return;
+        case 0x65: snprintf(buf, len, "LD   V%X, [I]", x); return;
+        }
+        break;
+    }
+    snprintf(buf, len, "DW   0x%04X", (int)ins);
+}
+
+
+////////////////////////////////////////////////////////////
+//                          Cache                         //
+////////////////////////////////////////////////////////////
+
+// $XDG_CACHE_HOME/chip8emu/<hash>, falling back to ~/.cache/chip8emu/<hash>
+// creates the directory when needed
+static bool cache_path(unsigned long long hash, char *path, size_t len) {
+    char dir[512];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    if (xdg != NULL && xdg[0] != '\0') {
+        snprintf(dir, sizeof(dir), "%s/chip8emu", xdg);
+        mkdir(xdg, 0755);
+    }
+    else if (home != NULL) {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+        mkdir(dir, 0755);
+        snprintf(dir, sizeof(dir), "%s/.cache/chip8emu", home);
+    }
+    else {
+        return false;
+    }
+    mkdir(dir, 0755);
+
+    snprintf(path, len, "%s/%016llx", dir, hash);
+    return true;
+}
+
+// load a cached analysis
+// return false if there's no cache entry for this hash, or it's from another
+// version or incomplete
+bool analysis_cache_load(unsigned long long hash, Analysis *an) {
+    char path[600];
+    if (!cache_path(hash, path, sizeof(path))) {
+        return false;
+    }
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    memset(an, 0, sizeof(Analysis));
+    an->rom_hash = hash;
+
+    char line[128], kind[8];
+    int a, start, end;
+    if (fgets(line, sizeof(line), file) == NULL
+        || sscanf(line, "chip8analyze %d", &a) != 1 || a != ANALYSIS_VERSION) {
+        fclose(file);
+        return false;
+    }
+
+    // all three profile lines must be there
+    int profile = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "shift %d %d %d %d", &an->shift_xy, &an->shift_vy_votes, &an->shift_vx_votes, &a) == 4) {
+            an->shift_use_vy = a;
+            profile |= 1;
+        }
+        else if (sscanf(line, "jump %d %d %d %d", &an->jump_offset, &an->jump_vx_votes, &an->jump_v0_votes, &a) == 4) {
+            an->jump_offset_vx = a;
+            profile |= 2;
+        }
+        else if (sscanf(line, "store_load %d %d %d %d", &an->store_load, &an->inc_votes, &an->no_inc_votes, &a) == 4) {
+            an->store_load_i_inc = a;
+            profile |= 4;
+        }
+        else if (sscanf(line, "region %7s %x %x", kind, &start, &end) == 3 && an->region_count < MAX_REGIONS) {
+            an->regions[an->region_count++] = (Region){ start, end, strcmp(kind, "code") == 0 };
+        }
+    }
+
+    fclose(file);
+    return profile == 7;
+}
+
+// save an analysis under its rom hash
+// return false if the cache can't be written
+bool analysis_cache_store(const Analysis *an) {
+    char path[600];
+    if (!cache_path(an->rom_hash, path, sizeof(path))) {
+        return false;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "chip8analyze %d\n", ANALYSIS_VERSION);
+    // <count> <votes for> <votes against> <recommended>
+    fprintf(file, "shift %d %d %d %d\n", an->shift_xy, an->shift_vy_votes, an->shift_vx_votes, an->shift_use_vy);
+    fprintf(file, "jump %d %d %d %d\n", an->jump_offset, an->jump_vx_votes, an->jump_v0_votes, an->jump_offset_vx);
+    fprintf(file, "store_load %d %d %d %d\n", an->store_load, an->inc_votes, an->no_inc_votes, an->store_load_i_inc);
+    for (int i=0; i<an->region_count; i++) {
+        fprintf(file, "region %s %03X %03X\n", an->regions[i].code ? "code" : "data",
+                an->regions[i].start, an->regions[i].end);
+    }
+
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,49 @@
+#include <string.h>
+
+#include "aot.h"
+#include "chip8.h"
+#include "cpu.h"
+
+// index compiled blocks by start address
+void aot_load(const AotProgram *prog, AotTable *table) {
+    memset(table, 0, sizeof(AotTable));
+    table->prog = prog;
+    for (int i=0; i<prog->block_count; i++) {
+        table->at[prog->blocks[i].start] = &prog->blocks[i];
+    }
+}
+
+// execute up to budget instructions, using compiled blocks where possible
+// falls back to the interpreter when:
+// - no block starts at the program counter (BNNN / 00EE targets, unreached code)
+// - the block doesn't fit in the remaining budget (keeps 60hz timing identical)
+// - memory under the block no longer matches the rom (self-modifying code)
+// return instructions executed
+int aot_run(Chip8 *emu, AotTable *table, int budget) {
+    const AotProgram *prog = table->prog;
+    int executed = 0;
+
+    while (executed < budget && emu->program_counter < 0xFFF) {
+        int pc = emu->program_counter;
+        const AotBlock *blk = table->at[pc];
+
+        if (blk != NULL && blk->len <= budget - executed
+            && memcmp(&emu->memory[pc], prog->image + (pc - 0x200), blk->len * 2) == 0) {
+            executed += blk->run(emu);
+            table->compiled += blk->len;
+        }
+        else {
+            execute_instruction(emu);
+            executed++;
+            table->interpreted++;
+        }
+    }
+
+    return executed;
+}
+
+// same as run_frame, with compiled blocks
+void aot_run_frame(Chip8 *emu, AotTable *table) {
+    aot_run(emu, table, frame_instructions(emu));
+    tick_timers(emu);
+}
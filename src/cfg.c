@@ -0,0 +1,140 @@
+#include <string.h>
+
+#include "cfg.h"
+#include "cpu.h"
+
+////////////////////////////////////////////////////////////
+//                     Control Flow                       //
+////////////////////////////////////////////////////////////
+
+// does this instruction end a basic block
+// anything that can set the program counter to something other than pc+2
+bool ends_block(unsigned _BitInt(16) ins) {
+    switch (OP(ins)) {
+    case 0x0:
+        return NNN(ins) == 0x0EE;
+    case 0x1: case 0x2: case 0x3: case 0x4:
+    case 0x5: case 0x9: case 0xB: case 0xE:
+        return true;
+    case 0xF:
+        return NN(ins) == 0x0A;
+    }
+    return false;
+}
+
+// static successors of the instruction at addr
+// return number of successors written to succ (0 - dynamic)
+int successors(unsigned _BitInt(16) ins, int addr, int *succ) {
+    switch (OP(ins)) {
+    case 0x0:
+        if (NNN(ins) == 0x0EE) {
+            return 0; // return address comes from the stack
+        }
+        break;
+    case 0x1: // 1NNN
+        succ[0] = NNN(ins);
+        return 1;
+    case 0x2: // 2NNN - assume the subroutine returns
+        succ[0] = NNN(ins);
+        succ[1] = addr + 2;
+        return 2;
+    case 0x3: case 0x4: case 0x5: case 0x9: case 0xE: // skips
+        succ[0] = addr + 2;
+        succ[1] = addr + 4;
+        return 2;
+    case 0xB: // BNNN - offset from a register
+        return 0;
+    case 0xF:
+        if (NN(ins) == 0x0A) { // FX0A - repeats until a key is pressed
+            succ[0] = addr;
+            succ[1] = addr + 2;
+            return 2;
+        }
+        break;
+    }
+    succ[0] = addr + 2;
+    return 1;
+}
+
+// walk every path reachable from 0x200
+// memory  - 4096 bytes with the rom loaded at 0x200
+// rom_len - rom size in bytes
+void build_cfg(const unsigned _BitInt(8) *memory, int rom_len, Cfg *cfg) {
+    memset(cfg, 0, sizeof(Cfg));
+    cfg->rom_end = 0x200 + rom_len;
+
+    // each block end queues at most two successors
+    int work[4096 * 2 + 1];
+    int work_len = 0;
+    work[work_len++] = 0x200;
+    cfg->leader[0x200] = true;
+
+    while (work_len > 0) {
+        int addr = work[--work_len];
+        int index = -1;  // index register, while statically known
+
+        // follow straight-line code until a block end or already visited code
+        bool joined = true;
+        while (!cfg->code[addr]) {
+            if (addr < 0x200 || addr + 1 >= cfg->rom_end) {
+                joined = false;
+                break;
+            }
+            cfg->code[addr] = true;
+
+            unsigned _BitInt(16) ins = memory[addr] * 0x100 + memory[addr + 1];
+
+            // track I for store targets
+            bool unknown_store = false;
+            if (OP(ins) == 0xA) {
+                index = NNN(ins);
+            }
+            else if (OP(ins) == 0xF && (NN(ins) == 0x55 || NN(ins) == 0x33)) {
+                int len = NN(ins) == 0x55 ? X(ins) + 1 : 3;
+                unknown_store = index < 0;
+                for (int i=0; index >= 0 && i<len && index+i < 4096; i++) {
+                    cfg->written[index+i] = true;
+                }
+                if (NN(ins) == 0x55) {
+                    index = -1; // store_load_i_inc may move I
+                }
+            }
+            else if (OP(ins) == 0xF && (NN(ins) == 0x1E || NN(ins) == 0x29 || NN(ins) == 0x65)) {
+                index = -1;
+            }
+
+            // a store to an unknown address may rewrite the rest of the block,
+            // end it so the next block is checked before it runs
+            if (!ends_block(ins) && !unknown_store) {
+                addr += 2;
+                continue;
+            }
+
+            // block end - queue successors as new blocks
+            cfg->block_end[addr] = true;
+            joined = false;
+            int succ[2];
+            int count = successors(ins, addr, succ);
+            if (count == 0) {
+                cfg->dynamic[addr] = true;
+            }
+            for (int i=0; i<count; i++) {
+                if (succ[i] >= 0x200 && succ[i] + 1 < cfg->rom_end) {
+                    cfg->leader[succ[i]] = true;
+                    if (!cfg->code[succ[i]]) {
+                        work[work_len++] = succ[i];
+                    }
+                }
+                else {
+                    cfg->dynamic[addr] = true;
+                }
+            }
+            break;
+        }
+
+        // fell through into code walked earlier, it starts a block too
+        if (joined) {
+            cfg->leader[addr] = true;
+        }
+    }
+}
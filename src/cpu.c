@@ -0,0 +1,337 @@
+#include "chip8.h"
+#include "cpu.h"
+#include "instructions.h"
+
+// fetch, decode & execute the instruction at the program counter
+// return FAULT_NONE, or the fault that stopped the instruction (see cpu.h)
+int execute_instruction(Chip8 *emu) {
+    if (emu->program_counter > 0xFFE) {
+        return FAULT_MEM_BOUNDS; // fetch past the end of memory
+    }
+
+    // FETCH
+    unsigned _BitInt(16) curr_ins
+        = emu->memory[emu->program_counter] * 0x100
+        + emu->memory[emu->program_counter + 1];
+    emu->program_counter += 2;
+
+    return execute_opcode(emu, curr_ins);
+}
+
+// decode & execute an already fetched instruction (program counter already past it)
+// return FAULT_NONE, or the fault that stopped the instruction (see cpu.h)
+int execute_opcode(Chip8 *emu, unsigned _BitInt(16) curr_ins) {
+    // DECODE & EXECUTE
+    switch (OP(curr_ins)) {
+    case 0x0:
+        switch (NNN(curr_ins)) {
+        case 0x0E0: // 00E0
+            disp_clear(emu);
+            //print_display_full(emu);
+            break;
+
+        case 0x0EE: // 00EE
+            if (subroutine_return(emu)) {
+                return FAULT_STACK_UNDERFLOW;
+            }
+            break;
+
+        default:    // 0NNN : machine code routine, not supported
+            return FAULT_BAD_OPCODE;
+        }
+        break;
+
+    case 0x1: // 1NNN
+        jump(emu, NNN(curr_ins));
+        break;
+
+    case 0x2: // 2NNN
+        if (subroutine_call(emu, NNN(curr_ins))) {
+            return FAULT_STACK_OVERFLOW;
+        }
+        break;
+
+    case 0x3: // 3XNN
+        skip_equal_const(emu, X(curr_ins), NN(curr_ins));
+        break;
+
+    case 0x4: // 4XNN
+        skip_not_equal_const(emu, X(curr_ins), NN(curr_ins));
+        break;
+
+    case 0x5: // 5XY0
+        if (N(curr_ins) != 0) {
+            return FAULT_BAD_OPCODE;
+        }
+        skip_equal(emu, X(curr_ins), Y(curr_ins));
+        break;
+
+    case 0x6: // 6XNN
+        set_const(emu, X(curr_ins), NN(curr_ins));
+        break;
+
+    case 0x7: // 7XNN
+        add_const(emu, X(curr_ins), NN(curr_ins));
+        break;
+
+    case 0x8:
+        switch (N(curr_ins)) {
+        case 0x0: // 8XY0
+            set(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x1: // 8XY1
+            bitwise_or(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x2: // 8XY2
+            bitwise_and(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x3: // 8XY3
+            bitwise_xor(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x4: // 8XY4
+            add(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x5: // 8XY5
+            subtract_x_y(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x6: // 8XY6
+            bitwise_shift_right(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0x7: // 8XY7
+            subtract_y_x(emu, X(curr_ins), Y(curr_ins));
+            break;
+        case 0xE: // 8XYE
+            bitwise_shift_left(emu, X(curr_ins), Y(curr_ins));
+            break;
+        default:
+            return FAULT_BAD_OPCODE;
+        }
+        break;
+
+    case 0x9: // 9XY0
+        if (N(curr_ins) != 0) {
+            return FAULT_BAD_OPCODE;
+        }
+        skip_not_equal(emu, X(curr_ins), Y(curr_ins));
+        break;
+
+    case 0xA: // ANNN
+        set_index(emu, NNN(curr_ins));
+        break;
+
+    case 0xB: // BNNN
+        jump_offset(emu, NNN(curr_ins));
+        break;
+
+    case 0xC: // CXNN
+        gen_rand(emu, X(curr_ins), NN(curr_ins));
+        break;
+
+    case 0xD: // DXYN
+        if (draw(emu, X(curr_ins), Y(curr_ins), N(curr_ins))) {
+            return FAULT_MEM_BOUNDS;
+        }
+        break;
+
+    case 0xE:
+        switch (NN(curr_ins)) {
+        case 0x9E: // EX9E
+            skip_key_pressed(emu, X(curr_ins));
+            break;
+        case 0xA1: // EXA1
+            skip_key_not_pressed(emu, X(curr_ins));
+            break;
+        default:
+            return FAULT_BAD_OPCODE;
+        }
+        break;
+
+    case 0xF:
+        switch (NN(curr_ins)) {
+        case 0x07: // FX07
+            get_delay(emu, X(curr_ins));
+            break;
+        case 0x0A: // FX0A
+            await_key(emu, X(curr_ins));
+            break;
+        case 0x15: // FX15
+            delay_timer(emu, X(curr_ins));
+            break;
+        case 0x18: // FX18
+            sound_timer(emu, X(curr_ins));
+            break;
+        case 0x1E: // FX1E
+            add_index(emu, X(curr_ins));
+            break;
+        case 0x29: // FX29
+            sprite_index(emu, X(curr_ins));
+            break;
+        case 0x33: // FX33
+            if (bcd(emu, X(curr_ins))) {
+                return FAULT_MEM_BOUNDS;
+            }
+            break;
+        case 0x55: // FX55
+            if (reg_dump(emu, X(curr_ins))) {
+                return FAULT_MEM_BOUNDS;
+            }
+            break;
+        case 0x65: // FX65
+            if (reg_load(emu, X(curr_ins))) {
+                return FAULT_MEM_BOUNDS;
+            }
+            break;
+        default:
+            return FAULT_BAD_OPCODE;
+        }
+        break;
+    }
+    return FAULT_NONE;
+}
+
+// fetch, decode & execute the instruction at the program counter, fusing it
+// with the instructions after it when they form a common idiom
+// budget - instructions left in this frame, fused ops never go past it so
+//          timers still tick at exactly the same point
+// return instructions retired (1 unless fused)
+int execute_fused(Chip8 *emu, int budget) {
+    int pc = emu->program_counter;
+    unsigned _BitInt(16) ins0 = emu->memory[pc] * 0x100 + emu->memory[pc + 1];
+
+    // only idiom starts need to look at the next instruction
+    int op = OP(ins0);
+    if (budget < 2 || pc > 0xFFA || (op != 0x6 && op != 0x7 && op != 0xA && op != 0xF)) {
+        emu->program_counter = pc + 2;
+        execute_opcode(emu, ins0);
+        return 1;
+    }
+
+    unsigned _BitInt(16) ins1 = emu->memory[pc + 2] * 0x100 + emu->memory[pc + 3];
+    int retired = 0;
+    int idiom = -1;
+
+    switch (OP(ins0)) {
+    case 0x6: // 6XNN + FX15 : set delay timer to a constant
+        if (OP(ins1) == 0xF && NN(ins1) == 0x15 && X(ins1) == X(ins0)) {
+            emu->program_counter = pc + 4;
+            set_const(emu, X(ins0), NN(ins0));
+            delay_timer(emu, X(ins0));
+            retired = 2;
+            idiom = FUSE_SET_DELAY;
+        }
+        break;
+
+    case 0xA: // ANNN + DXYN : draw sprite at a constant address
+        if (OP(ins1) == 0xD) {
+            emu->program_counter = pc + 4;
+            set_index(emu, NNN(ins0));
+            draw(emu, X(ins1), Y(ins1), N(ins1));
+            retired = 2;
+            idiom = FUSE_DRAW_CONST;
+        }
+        break;
+
+    case 0x7: // 7XNN chain
+        if (OP(ins1) == 0x7) {
+            unsigned _BitInt(16) ins = ins0;
+            while (retired < budget && OP(ins) == 0x7) {
+                add_const(emu, X(ins), NN(ins));
+                retired++;
+                int next = pc + retired * 2;
+                if (next > 0xFFD) {
+                    break;
+                }
+                ins = emu->memory[next] * 0x100 + emu->memory[next + 1];
+            }
+            emu->program_counter = pc + retired * 2;
+            idiom = FUSE_ADD_CHAIN;
+        }
+        break;
+
+    case 0xF:
+        // FX07 + 3X00 + 1NNN : spin until the delay timer runs out
+        // the timer only changes at the end of the frame, so every remaining
+        // iteration this frame does the same thing
+        if (NN(ins0) == 0x07 && (ins1 & 0xF0FF) == 0x3000 && X(ins1) == X(ins0)
+            && budget >= 3 && pc <= 0xFF8) {
+            unsigned _BitInt(16) ins2 = emu->memory[pc + 4] * 0x100 + emu->memory[pc + 5];
+            if (ins2 == (0x1000 | pc)) {
+                get_delay(emu, X(ins0));
+                if (emu->delay_timer == 0) {
+                    emu->program_counter = pc + 6; // 3X00 skips the jump
+                    retired = 2;
+                } else {
+                    emu->program_counter = pc;
+                    retired = budget - budget % 3;
+                }
+                idiom = FUSE_DELAY_WAIT;
+            }
+        }
+        // FX33 + FY65 : print a number (digits to memory, back into V0-VY)
+        // not when the digits [I, I+2] overwrite the FY65 itself
+        else if (NN(ins0) == 0x33 && OP(ins1) == 0xF && NN(ins1) == 0x65
+                 && (emu->index_register + 2 < pc + 2 || emu->index_register > pc + 3)) {
+            emu->program_counter = pc + 4;
+            bcd(emu, X(ins0));
+            reg_load(emu, X(ins1));
+            retired = 2;
+            idiom = FUSE_BCD_LOAD;
+        }
+        break;
+    }
+
+    if (idiom == -1) {
+        emu->program_counter = pc + 2;
+        execute_opcode(emu, ins0);
+        return 1;
+    }
+    emu->fused[idiom]++;
+    emu->fused_retired += retired;
+    return retired;
+}
+
+// number of instructions due in the current 60hz frame
+// spreads inst_per_sec over 60 frames without drifting (700 -> 11 or 12)
+int frame_instructions(Chip8 *emu) {
+    unsigned long frame = emu->frame_count % 60;
+    return (int)(((frame + 1) * emu->inst_per_sec) / 60 - (frame * emu->inst_per_sec) / 60);
+}
+
+// end of 60hz cycle - decrement timers if above 0, count the frame
+void tick_timers(Chip8 *emu) {
+    if (emu->sound_timer > 0) {
+        emu->sound_timer--;
+    }
+    if (emu->delay_timer > 0) {
+        emu->delay_timer--;
+    }
+    emu->frame_count++;
+}
+
+// run one 60hz frame as fast as possible (headless)
+// fuses common idioms unless disabled or the debugger needs every instruction
+void run_frame(Chip8 *emu) {
+    int count = frame_instructions(emu);
+    bool fuse = emu->fuse_ops && !emu->debug_armed;
+    for (int i=0; i<count && emu->program_counter < 0xFFF; ) {
+        if (fuse) {
+            i += execute_fused(emu, count - i);
+        } else {
+            execute_instruction(emu);
+            i++;
+        }
+    }
+    tick_timers(emu);
+}
+
+// FNV-1a over the display rows, for comparing frame timelines
+unsigned long long display_hash(Chip8 *emu) {
+    unsigned long long hash = 0xCBF29CE484222325;
+    for (int i=0; i<32; i++) {
+        for (int b=0; b<64; b+=8) {
+            hash ^= (unsigned long long)(emu->display[i] >> b) & 0xFF;
+            hash *= 0x100000001B3;
+        }
+    }
+    return hash;
+}
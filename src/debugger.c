@@ -0,0 +1,394 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chip8.h"
+#include "debugger.h"
+#include "term_disp.h"
+
+// command results
+#define CMD_NONE   0
+#define CMD_RESUME 1
+#define CMD_QUIT   2
+#define CMD_PAUSE  3
+
+#define BIT_TEST(map, i) ((map[(i) >> 6] >> ((i) & 63)) & 1)
+#define BIT_SET(map, i) (map[(i) >> 6] |= (unsigned _BitInt(64))1 << ((i) & 63))
+#define BIT_CLEAR(map, i) (map[(i) >> 6] &= ~((unsigned _BitInt(64))1 << ((i) & 63)))
+
+static void rearm(Chip8*);
+static int  run_command(Chip8*, char*);
+static int  read_line(Debugger*, bool);
+static void print_regs(Chip8*);
+
+////////////////////////////////////////////////////////////
+//                     Attach / Detach                    //
+////////////////////////////////////////////////////////////
+
+// attach a debugger to the emulator
+// path - "-" for stdin/stderr, otherwise a UNIX socket path to listen on
+// the emulator starts paused so breakpoints can be set before the first instruction
+// return 0 - successful completion
+// return 1 - could not open the command interface
+int debugger_attach(Chip8 *emu, const char *path) {
+    Debugger *dbg = (Debugger*)calloc(1, sizeof(Debugger));
+    dbg->listen_fd = -1;
+
+    if (strcmp(path, "-") == 0) {
+        dbg->in_fd = STDIN_FILENO;
+        dbg->out_fd = STDERR_FILENO;
+    }
+    else {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+        strncpy(dbg->path, addr.sun_path, sizeof(dbg->path) - 1);
+        unlink(path);
+
+        dbg->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (dbg->listen_fd == -1
+            || bind(dbg->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1
+            || listen(dbg->listen_fd, 1) == -1) {
+            if (dbg->listen_fd != -1)
+                close(dbg->listen_fd);
+            free(dbg);
+            return 1;
+        }
+
+        // block until a client connects
+        printf("Waiting for debugger on %s\n", path);
+        dbg->in_fd = accept(dbg->listen_fd, NULL, NULL);
+        if (dbg->in_fd == -1) {
+            close(dbg->listen_fd);
+            unlink(path);
+            free(dbg);
+            return 1;
+        }
+        dbg->out_fd = dbg->in_fd;
+    }
+
+    dbg->stepping = true;
+    emu->debugger = dbg;
+    rearm(emu);
+    return 0;
+}
+
+// detach and free the debugger
+void debugger_detach(Chip8 *emu) {
+    Debugger *dbg = emu->debugger;
+    if (dbg == NULL) {
+        return;
+    }
+
+    if (dbg->listen_fd != -1) {
+        close(dbg->in_fd);
+        close(dbg->listen_fd);
+        unlink(dbg->path);
+    }
+    free(dbg);
+    emu->debugger = NULL;
+    emu->debug_armed = false;
+}
+
+// only keep the dispatcher checking while something can stop it
+static void rearm(Chip8 *emu) {
+    Debugger *dbg = emu->debugger;
+    emu->debug_armed = dbg->bp_count > 0 || dbg->wp_count > 0 || dbg->watch_rows != 0
+                    || dbg->stepping || dbg->watch_hit;
+}
+
+
+////////////////////////////////////////////////////////////
+//                    Dispatcher Hooks                    //
+////////////////////////////////////////////////////////////
+
+// check whether execution should stop before the instruction at the program counter
+bool debugger_check(Chip8 *emu) {
+    Debugger *dbg = emu->debugger;
+    int pc = emu->program_counter;
+
+    if (dbg->watch_hit) {
+        dbg->watch_hit = false;
+        rearm(emu);
+        snprintf(dbg->stop_reason, sizeof(dbg->stop_reason), "watchpoint 0x%03X written by 0x%03X\n",
+                 (int)dbg->watch_addr, (int)dbg->watch_pc);
+        return true;
+    }
+
+    if (dbg->stepping) {
+        dbg->stepping = false;
+        rearm(emu);
+        return true;
+    }
+
+    if (BIT_TEST(dbg->breakpoints, pc)) {
+        DebugCond *cond = &dbg->conds[pc];
+        int reg = emu->var_regs[cond->reg];
+        int val = cond->val;
+        bool hit = cond->cmp == CMP_NONE
+                || (cond->cmp == CMP_EQ && reg == val)
+                || (cond->cmp == CMP_NE && reg != val)
+                || (cond->cmp == CMP_LT && reg < val)
+                || (cond->cmp == CMP_GT && reg > val);
+        if (hit) {
+            snprintf(dbg->stop_reason, sizeof(dbg->stop_reason), "breakpoint 0x%03X\n", pc);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// memory write - reg_dump / bcd
+void debugger_watch_mem(Chip8 *emu, unsigned _BitInt(16) addr) {
+    Debugger *dbg = emu->debugger;
+    if (addr < 4096 && BIT_TEST(dbg->watchpoints, addr)) {
+        dbg->watch_hit = true;
+        dbg->watch_addr = addr;
+        dbg->watch_pc = emu->program_counter - 2;
+    }
+}
+
+// display row write - draw / disp_clear
+void debugger_watch_row(Chip8 *emu, int row) {
+    Debugger *dbg = emu->debugger;
+    if ((dbg->watch_rows >> row) & 1) {
+        dbg->watch_hit = true;
+        dbg->watch_addr = row;
+        dbg->watch_pc = emu->program_counter - 2;
+    }
+}
+
+
+////////////////////////////////////////////////////////////
+//                    Command Interface                   //
+////////////////////////////////////////////////////////////
+
+// stopped - read & run commands until execution resumes
+// return 0 - resume execution
+// return 1 - quit
+int debugger_prompt(Chip8 *emu) {
+    Debugger *dbg = emu->debugger;
+    bool on_terminal = dbg->in_fd == STDIN_FILENO;
+    int rtn = 0;
+
+    if (on_terminal) {
+        term_disp_suspend();
+    }
+
+    // stop reason from debugger_check, after the suspend so it isn't drawn over
+    if (dbg->stop_reason[0] != '\0') {
+        dprintf(dbg->out_fd, "%s", dbg->stop_reason);
+        dbg->stop_reason[0] = '\0';
+    }
+
+    int pc = emu->program_counter;
+    dprintf(dbg->out_fd, "0x%03X: %02X%02X\n", pc,
+            (int)emu->memory[pc], (int)emu->memory[(pc + 1) & 0xFFF]);
+
+    for (;;) {
+        dprintf(dbg->out_fd, "(chip8) ");
+        if (read_line(dbg, true) == -1) {
+            rtn = 1;
+            break;
+        }
+
+        int cmd = run_command(emu, dbg->line);
+        if (cmd == CMD_RESUME) {
+            break;
+        }
+        if (cmd == CMD_QUIT) {
+            rtn = 1;
+            break;
+        }
+    }
+
+    if (on_terminal) {
+        term_disp_resume();
+    }
+    rearm(emu);
+    return rtn;
+}
+
+// running - run any commands already waiting without blocking
+// return 0 - keep running
+// return 1 - quit
+int debugger_poll(Chip8 *emu) {
+    Debugger *dbg = emu->debugger;
+
+    struct pollfd pfd = { .fd = dbg->in_fd, .events = POLLIN };
+    if (poll(&pfd, 1, 0) <= 0) {
+        return 0;
+    }
+
+    int len;
+    while ((len = read_line(dbg, false)) > 0) {
+        int cmd = run_command(emu, dbg->line);
+        if (cmd == CMD_QUIT) {
+            return 1;
+        }
+        if (cmd == CMD_PAUSE) {
+            dbg->stepping = true;
+        }
+    }
+    rearm(emu);
+    return len == -1;
+}
+
+// read one line into dbg->line
+// return  1 - line available
+// return  0 - no complete line yet (non-blocking only)
+// return -1 - command interface closed
+static int read_line(Debugger *dbg, bool block) {
+    for (;;) {
+        char *nl = memchr(dbg->buf, '\n', dbg->buf_len);
+        if (nl != NULL) {
+            // hand out the line, keep the rest buffered for the next call
+            int len = nl - dbg->buf;
+            memcpy(dbg->line, dbg->buf, len);
+            dbg->line[len] = '\0';
+            dbg->buf_len -= len + 1;
+            memmove(dbg->buf, nl + 1, dbg->buf_len);
+            return 1;
+        }
+
+        if (!block) {
+            struct pollfd pfd = { .fd = dbg->in_fd, .events = POLLIN };
+            if (poll(&pfd, 1, 0) <= 0) {
+                return 0;
+            }
+        }
+
+        // drop overlong lines
+        if (dbg->buf_len == sizeof(dbg->buf)) {
+            dbg->buf_len = 0;
+        }
+
+        ssize_t got = read(dbg->in_fd, dbg->buf + dbg->buf_len, sizeof(dbg->buf) - dbg->buf_len);
+        if (got <= 0) {
+            return -1;
+        }
+        dbg->buf_len += got;
+    }
+}
+
+// parse & run a single command line
+static int run_command(Chip8 *emu, char *line) {
+    Debugger *dbg = emu->debugger;
+    char cmd[8] = "";
+    unsigned int addr = 0, len = 1, reg = 0, val = 0;
+    char op[3] = "";
+
+    int args = sscanf(line, "%7s %x %x", cmd, &addr, &len);
+    if (args < 1) {
+        return CMD_NONE;
+    }
+    if (args < 3) {
+        len = 1;
+    }
+    addr &= 0xFFF;
+
+    // b ADDR [vX OP NN] : set breakpoint, optionally conditional on a register
+    if (strcmp(cmd, "b") == 0 && args >= 2) {
+        DebugCond cond = { CMP_NONE, 0, 0 };
+        if (sscanf(line, "%*s %*x v%x %2[=!<>] %x", &reg, op, &val) == 3) {
+            cond.reg = reg & 0xF;
+            cond.val = val & 0xFF;
+            cond.cmp = strcmp(op, "==") == 0 ? CMP_EQ
+                     : strcmp(op, "!=") == 0 ? CMP_NE
+                     : strcmp(op, "<") == 0  ? CMP_LT
+                     : strcmp(op, ">") == 0  ? CMP_GT : CMP_NONE;
+        }
+        if (!BIT_TEST(dbg->breakpoints, addr)) {
+            BIT_SET(dbg->breakpoints, addr);
+            dbg->bp_count++;
+        }
+        dbg->conds[addr] = cond;
+    }
+    // d ADDR : delete breakpoint
+    else if (strcmp(cmd, "d") == 0 && args >= 2) {
+        if (BIT_TEST(dbg->breakpoints, addr)) {
+            BIT_CLEAR(dbg->breakpoints, addr);
+            dbg->bp_count--;
+        }
+        dbg->conds[addr].cmp = CMP_NONE;
+    }
+    // w ADDR [LEN] / dw ADDR [LEN] : set / delete memory write watchpoints
+    else if ((strcmp(cmd, "w") == 0 || strcmp(cmd, "dw") == 0) && args >= 2) {
+        bool set = cmd[0] == 'w';
+        for (unsigned int i=addr; i<addr+len && i<4096; i++) {
+            if (set && !BIT_TEST(dbg->watchpoints, i)) {
+                BIT_SET(dbg->watchpoints, i);
+                dbg->wp_count++;
+            }
+            else if (!set && BIT_TEST(dbg->watchpoints, i)) {
+                BIT_CLEAR(dbg->watchpoints, i);
+                dbg->wp_count--;
+            }
+        }
+    }
+    // wr ROW / dwr ROW : set / delete display row watchpoints
+    else if ((strcmp(cmd, "wr") == 0 || strcmp(cmd, "dwr") == 0) && args >= 2) {
+        unsigned _BitInt(32) bit = (unsigned _BitInt(32))1 << (addr & 31);
+        if (cmd[0] == 'w') {
+            dbg->watch_rows |= bit;
+        } else {
+            dbg->watch_rows &= ~bit;
+        }
+    }
+    // m ADDR [LEN] : dump memory
+    else if (strcmp(cmd, "m") == 0 && args >= 2) {
+        for (unsigned int i=0; i<len && addr+i<4096; i++) {
+            dprintf(dbg->out_fd, (i % 16 == 15 || i == len - 1) ? "%02X\n" : "%02X ",
+                    (int)emu->memory[addr+i]);
+        }
+    }
+    else if (strcmp(cmd, "r") == 0) {
+        print_regs(emu);
+    }
+    else if (strcmp(cmd, "s") == 0) {
+        dbg->stepping = true;
+        return CMD_RESUME;
+    }
+    else if (strcmp(cmd, "c") == 0) {
+        return CMD_RESUME;
+    }
+    else if (strcmp(cmd, "p") == 0) {
+        return CMD_PAUSE;
+    }
+    else if (strcmp(cmd, "q") == 0) {
+        return CMD_QUIT;
+    }
+    else {
+        dprintf(dbg->out_fd,
+            "b ADDR [vX OP NN]   breakpoint (OP: == != < >)\n"
+            "d ADDR              delete breakpoint\n"
+            "w ADDR [LEN]        memory write watchpoint\n"
+            "dw ADDR [LEN]       delete memory watchpoint\n"
+            "wr ROW / dwr ROW    display row watchpoint\n"
+            "m ADDR [LEN]        dump memory\n"
+            "r                   registers\n"
+            "s / c / p / q       step / continue / pause / quit\n");
+    }
+
+    rearm(emu);
+    return CMD_NONE;
+}
+
+// print registers, timers & stack
+static void print_regs(Chip8 *emu) {
+    Debugger *dbg = emu->debugger;
+
+    dprintf(dbg->out_fd, "PC=%03X I=%03X DT=%02X ST=%02X SP=%d\n",
+            (int)emu->program_counter, (int)emu->index_register,
+            (int)emu->delay_timer, (int)emu->sound_timer, emu->stack_top);
+    for (int i=0; i<16; i++) {
+        dprintf(dbg->out_fd, i == 15 ? "V%X=%02X\n" : "V%X=%02X ", i, (int)emu->var_regs[i]);
+    }
+    for (int i=0; i<=emu->stack_top; i++) {
+        dprintf(dbg->out_fd, i == emu->stack_top ? "%03X\n" : "%03X ", (int)emu->stack[i]);
+    }
+}
@@ -0,0 +1,353 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "fuzzer.h"
+#include "init.h"
+
+// coverage guided fuzzer - each worker restores a saved state from the corpus,
+// runs one segment of mutated key presses & rng seed and keeps the resulting
+// state if it reached a new pc or edge (prev pc >> 1 ^ pc)
+// segments stop at the first fault (cpu.h), distinct faults are kept with the
+// chain of segments that reproduces them from power-on
+
+// coverage of a single execution, reset through the touched lists
+typedef struct Coverage {
+    unsigned char pc[FUZZ_MAP];
+    unsigned char edge[FUZZ_MAP];
+    unsigned short pcs[FUZZ_MAP];
+    unsigned short edges[FUZZ_MAP];
+    int pc_count;
+    int edge_count;
+} Coverage;
+
+static const char *fault_names[FAULT_COUNT] = {
+    "none", "stack_overflow", "stack_underflow", "bad_opcode", "mem_bounds"
+};
+
+static void *worker_main(void*);
+static int  run_segment(Chip8*, const unsigned _BitInt(16)*, Coverage*, int*);
+static void mutate_keys(FuzzWorker*, const FuzzEntry*, unsigned _BitInt(16)*);
+
+// xorshift32, per worker
+static unsigned _BitInt(32) next_rand(FuzzWorker *w) {
+    unsigned _BitInt(32) r = w->rng;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    w->rng = r;
+    return r;
+}
+
+static int rand_below(FuzzWorker *w, int n) {
+    return (int)(next_rand(w) % n);
+}
+
+////////////////////////////////////////////////////////////
+//                     Create / Stop                      //
+////////////////////////////////////////////////////////////
+
+// start fuzzing from initial's state on worker threads (usually one per core)
+// seed - seeds the workers' mutations, same seed & one worker repeats a run
+Fuzzer* fuzzer_new(Chip8 *initial, int workers, unsigned _BitInt(32) seed) {
+    Fuzzer *fz = (Fuzzer*)calloc(1, sizeof(Fuzzer));
+    fz->worker_count = workers < 1 ? 1 : workers;
+    fz->workers = (FuzzWorker*)calloc(fz->worker_count, sizeof(FuzzWorker));
+    fz->corpus = (FuzzEntry*)calloc(FUZZ_CORPUS, sizeof(FuzzEntry));
+    pthread_mutex_init(&fz->lock, NULL);
+
+    // entry 0 - power-on
+    fz->corpus[0].parent = -1;
+    fz->corpus[0].seed = initial->rng_state;
+    snapshot_chip8(initial, &fz->corpus[0].state);
+    atomic_store(&fz->corpus_count, 1);
+
+    for (int i=0; i<fz->worker_count; i++) {
+        FuzzWorker *w = &fz->workers[i];
+        w->fuzz = fz;
+        w->rng = (seed ^ (unsigned _BitInt(32))((i + 1) * 0x9E3779B9U)) | 1;
+        pthread_create(&w->thread, NULL, worker_main, w);
+    }
+    return fz;
+}
+
+// stop & join all workers, corpus & crashes stay readable
+void fuzzer_stop(Fuzzer *fz) {
+    atomic_store(&fz->stopping, true);
+    for (int i=0; i<fz->worker_count; i++) {
+        pthread_join(fz->workers[i].thread, NULL);
+    }
+}
+
+// free the fuzzer after fuzzer_stop
+void fuzzer_free(Fuzzer *fz) {
+    pthread_mutex_destroy(&fz->lock);
+    free(fz->corpus);
+    free(fz->workers);
+    free(fz);
+}
+
+// executions so far, all workers
+unsigned long fuzzer_execs(Fuzzer *fz) {
+    unsigned long execs = 0;
+    for (int i=0; i<fz->worker_count; i++) {
+        execs += atomic_load_explicit(&fz->workers[i].execs, memory_order_relaxed);
+    }
+    return execs;
+}
+
+
+////////////////////////////////////////////////////////////
+//                         Worker                         //
+////////////////////////////////////////////////////////////
+
+static void *worker_main(void *arg) {
+    FuzzWorker *w = (FuzzWorker*)arg;
+    Fuzzer *fz = w->fuzz;
+
+    Chip8 *emu = (Chip8*)malloc(sizeof(Chip8));
+    Coverage *cov = (Coverage*)calloc(1, sizeof(Coverage));
+    unsigned _BitInt(16) keys[FUZZ_FRAMES];
+
+    // this worker's copy of the global maps, only changes under lock
+    // faults this worker already reported
+    unsigned char *seen_pc = (unsigned char*)calloc(FUZZ_MAP, 1);
+    unsigned char *seen_edge = (unsigned char*)calloc(FUZZ_MAP, 1);
+    unsigned char *seen_fault = (unsigned char*)calloc(FAULT_COUNT * FUZZ_MAP, 1);
+
+    while (!atomic_load_explicit(&fz->stopping, memory_order_relaxed)) {
+        // half the time start from the newest quarter of the corpus
+        int count = atomic_load_explicit(&fz->corpus_count, memory_order_acquire);
+        int parent = rand_below(w, count);
+        if (next_rand(w) & 1) {
+            parent = count - 1 - rand_below(w, (count + 3) / 4);
+        }
+        FuzzEntry *from = &fz->corpus[parent];
+
+        // fork from the saved state, continue its rng stream or reseed
+        restore_chip8(emu, &from->state);
+        unsigned _BitInt(32) seed = (next_rand(w) & 1) ? emu->rng_state : next_rand(w) | 1;
+        emu->rng_state = seed;
+        mutate_keys(w, from, keys);
+
+        int pc = 0;
+        int fault = run_segment(emu, keys, cov, &pc);
+        atomic_fetch_add_explicit(&w->execs, 1, memory_order_relaxed);
+
+        // anything this worker hasn't seen -> merge into the global maps
+        bool fresh = false;
+        for (int i=0; i<cov->pc_count && !fresh; i++) {
+            fresh = !seen_pc[cov->pcs[i]];
+        }
+        for (int i=0; i<cov->edge_count && !fresh; i++) {
+            fresh = !seen_edge[cov->edges[i]];
+        }
+        if (fresh) {
+            pthread_mutex_lock(&fz->lock);
+            bool new_global = false;
+            for (int i=0; i<cov->pc_count; i++) {
+                if (!fz->pc_map[cov->pcs[i]]) {
+                    fz->pc_map[cov->pcs[i]] = 1;
+                    atomic_fetch_add(&fz->pcs_covered, 1);
+                    new_global = true;
+                }
+            }
+            for (int i=0; i<cov->edge_count; i++) {
+                if (!fz->edge_map[cov->edges[i]]) {
+                    fz->edge_map[cov->edges[i]] = 1;
+                    atomic_fetch_add(&fz->edges_covered, 1);
+                    new_global = true;
+                }
+            }
+
+            // keep the state (a faulted segment's state is mid-frame, drop it)
+            int n = atomic_load_explicit(&fz->corpus_count, memory_order_relaxed);
+            if (new_global && fault == FAULT_NONE && n < FUZZ_CORPUS) {
+                FuzzEntry *entry = &fz->corpus[n];
+                entry->parent = parent;
+                entry->seed = seed;
+                memcpy(entry->keys, keys, sizeof(keys));
+                snapshot_chip8(emu, &entry->state);
+                atomic_store_explicit(&fz->corpus_count, n + 1, memory_order_release);
+            }
+
+            memcpy(seen_pc, fz->pc_map, FUZZ_MAP);
+            memcpy(seen_edge, fz->edge_map, FUZZ_MAP);
+            pthread_mutex_unlock(&fz->lock);
+        }
+
+        if (fault != FAULT_NONE) {
+            atomic_fetch_add_explicit(&fz->faults, 1, memory_order_relaxed);
+            if (!seen_fault[fault * FUZZ_MAP + pc]) {
+                seen_fault[fault * FUZZ_MAP + pc] = 1;
+
+                pthread_mutex_lock(&fz->lock);
+                int n = atomic_load(&fz->crash_count);
+                bool known = false;
+                for (int i=0; i<n && !known; i++) {
+                    known = fz->crashes[i].fault == fault && fz->crashes[i].pc == pc;
+                }
+                if (!known && n < FUZZ_CRASHES) {
+                    FuzzCrash *crash = &fz->crashes[n];
+                    crash->fault = fault;
+                    crash->pc = pc;
+                    crash->parent = parent;
+                    crash->seed = seed;
+                    memcpy(crash->keys, keys, sizeof(keys));
+                    atomic_store(&fz->crash_count, n + 1);
+                }
+                pthread_mutex_unlock(&fz->lock);
+            }
+        }
+
+        // reset this execution's coverage
+        for (int i=0; i<cov->pc_count; i++) {
+            cov->pc[cov->pcs[i]] = 0;
+        }
+        for (int i=0; i<cov->edge_count; i++) {
+            cov->edge[cov->edges[i]] = 0;
+        }
+        cov->pc_count = 0;
+        cov->edge_count = 0;
+    }
+
+    free(seen_fault);
+    free(seen_edge);
+    free(seen_pc);
+    free(cov);
+    free(emu);
+    return NULL;
+}
+
+// run FUZZ_FRAMES frames with the given keypad states
+// cov    - coverage to record into (NULL - don't record)
+// pc     - set to the faulting instruction's address
+// return FAULT_NONE or the first fault
+static int run_segment(Chip8 *emu, const unsigned _BitInt(16) *keys, Coverage *cov, int *pc) {
+    int prev = 0;
+    for (int f=0; f<FUZZ_FRAMES; f++) {
+        emu->keys = keys[f];
+        int count = frame_instructions(emu);
+        for (int i=0; i<count; i++) {
+            int curr = emu->program_counter;
+            int fault = execute_instruction(emu);
+
+            if (cov != NULL) {
+                int edge = ((prev >> 1) ^ curr) & (FUZZ_MAP - 1);
+                if (!cov->pc[curr]) {
+                    cov->pc[curr] = 1;
+                    cov->pcs[cov->pc_count++] = curr;
+                }
+                if (!cov->edge[edge]) {
+                    cov->edge[edge] = 1;
+                    cov->edges[cov->edge_count++] = edge;
+                }
+                prev = curr;
+            }
+
+            if (fault != FAULT_NONE) {
+                *pc = curr;
+                return fault;
+            }
+        }
+        tick_timers(emu);
+    }
+    return FAULT_NONE;
+}
+
+// mostly single key presses, half the frames with nothing pressed
+static unsigned _BitInt(16) rand_key(FuzzWorker *w) {
+    unsigned _BitInt(32) r = next_rand(w);
+    return (r & 1) ? 0 : (unsigned _BitInt(16))1 << ((r >> 1) & 0xF);
+}
+
+// new keypad states for a segment
+// - fresh random presses
+// - the parent segment's presses with a few frames changed
+// - one key held for a stretch of frames
+static void mutate_keys(FuzzWorker *w, const FuzzEntry *from, unsigned _BitInt(16) *keys) {
+    switch (rand_below(w, 3)) {
+    case 0:
+        for (int f=0; f<FUZZ_FRAMES; f++) {
+            keys[f] = rand_key(w);
+        }
+        break;
+
+    case 1:
+        memcpy(keys, from->keys, FUZZ_FRAMES * sizeof(keys[0]));
+        for (int n=1+rand_below(w, 4); n>0; n--) {
+            keys[rand_below(w, FUZZ_FRAMES)] = rand_key(w);
+        }
+        break;
+
+    case 2: {
+        memset(keys, 0, FUZZ_FRAMES * sizeof(keys[0]));
+        int start = rand_below(w, FUZZ_FRAMES);
+        int len = 1 + rand_below(w, FUZZ_FRAMES - start);
+        unsigned _BitInt(16) key = (unsigned _BitInt(16))1 << rand_below(w, 16);
+        for (int f=start; f<start+len; f++) {
+            keys[f] = key;
+        }
+        break;
+    }
+    }
+}
+
+
+////////////////////////////////////////////////////////////
+//                      Reproducers                       //
+////////////////////////////////////////////////////////////
+
+const char* fault_name(int fault) {
+    return fault >= 0 && fault < FAULT_COUNT ? fault_names[fault] : "unknown";
+}
+
+// write every segment from power-on to the fault (text, see fuzzer_replay)
+void fuzzer_write_repro(Fuzzer *fz, const FuzzCrash *crash, FILE *file) {
+    int *chain = (int*)malloc(FUZZ_CORPUS * sizeof(int));
+    int depth = 0;
+    for (int e=crash->parent; e>0; e=fz->corpus[e].parent) {
+        chain[depth++] = e;
+    }
+
+    fprintf(file, "# %s at 0x%03X, %d segments of %d frames\n",
+            fault_name(crash->fault), crash->pc, depth + 1, FUZZ_FRAMES);
+    for (int d=depth-1; d>=-1; d--) {
+        const unsigned _BitInt(16) *keys = d >= 0 ? fz->corpus[chain[d]].keys : crash->keys;
+        unsigned _BitInt(32) seed = d >= 0 ? fz->corpus[chain[d]].seed : crash->seed;
+        fprintf(file, "seed %08X\nkeys", (unsigned int)seed);
+        for (int f=0; f<FUZZ_FRAMES; f++) {
+            fprintf(file, " %04X", (unsigned int)keys[f]);
+        }
+        fprintf(file, "\n");
+    }
+    free(chain);
+}
+
+// run a reproducer written by fuzzer_write_repro on a power-on emulator
+// pc     - set to the faulting instruction's address
+// return FAULT_NONE if every segment ran clean, otherwise the fault
+int fuzzer_replay(Chip8 *emu, FILE *file, int *pc) {
+    char line[8 * FUZZ_FRAMES + 64];
+    unsigned int seed = 1;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "seed %x", &seed) == 1 || strncmp(line, "keys", 4) != 0) {
+            continue;
+        }
+
+        unsigned _BitInt(16) keys[FUZZ_FRAMES] = {0};
+        char *pos = line + 4;
+        for (int f=0; f<FUZZ_FRAMES; f++) {
+            keys[f] = strtoul(pos, &pos, 16);
+        }
+
+        emu->rng_state = seed;
+        int fault = run_segment(emu, keys, NULL, pc);
+        if (fault != FAULT_NONE) {
+            return fault;
+        }
+    }
+    return FAULT_NONE;
+}
@@ -1,8 +1,11 @@
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "init.h"
+#include "analyzer.h"
+#include "state_hash.h"
 
 ////////////////////////////////////////////////////////////
 //                       Chip8 Init                       //
@@ -10,7 +13,7 @@
 
 // initialize a new chip8 given rom file descriptor
 Chip8* new_chip8(int rom_fd) {
-    Chip8 *emu = (Chip8*)malloc(sizeof(Chip8));
+    Chip8 *emu = (Chip8*)calloc(1, sizeof(Chip8));
 
     unsigned _BitInt(8) font[] = {
         0x60, 0xB0, 0xD0, 0x90, 0x60,   // 0
@@ -44,9 +47,10 @@ Chip8* new_chip8(int rom_fd) {
 
     // config defaults
     emu->inst_per_sec = 700;
+    emu->fuse_ops = false;     // opt in with config_fusion, it loses on some roms
 
-    // srand
-    srand(time(NULL));
+    // seed random number generator (xorshift, must not be 0)
+    emu->rng_state = time(NULL) | 1;
 
     // read & load rom to memory (starting at address 0x200)
     unsigned _BitInt(8) buffer;
@@ -60,6 +64,21 @@ Chip8* new_chip8(int rom_fd) {
 }
 
 
+////////////////////////////////////////////////////////////
+//                     Chip8 Snapshot                     //
+////////////////////////////////////////////////////////////
+
+// copy the full machine state into snap
+void snapshot_chip8(Chip8 *emu, Chip8 *snap) {
+    memcpy(snap, emu, sizeof(Chip8));
+}
+
+// roll the machine back to a state saved with snapshot_chip8
+void restore_chip8(Chip8 *emu, Chip8 *snap) {
+    memcpy(emu, snap, sizeof(Chip8));
+}
+
+
 ////////////////////////////////////////////////////////////
 //                      Chip8 Config                      //
 ////////////////////////////////////////////////////////////
@@ -89,4 +108,37 @@ void config_jump_offset(Chip8 *emu, bool val) {
 // 1. Do increment index register during store and load instructions
 void config_store_load_inc(Chip8 *emu, bool val) {
     emu->store_load_i_inc = val;
-}
\ No newline at end of file
+}
+
+// Configure the quirks from the rom's static analysis (analyzer.h)
+// - rom_len: bytes loaded at 0x200
+// the analysis is cached by rom hash, so this may read & write the cache directory
+void config_quirk_analysis(Chip8 *emu, int rom_len) {
+    if (rom_len > 0x1000 - 0x200) {
+        rom_len = 0x1000 - 0x200;
+    }
+    Analysis *an = (Analysis*)malloc(sizeof(Analysis));
+    if (!analysis_cache_load(rom_hash(emu->memory, rom_len), an)) {
+        analyze_rom(emu->memory, rom_len, an);
+        analysis_cache_store(an);
+    }
+    apply_analysis(emu, an);
+    free(an);
+}
+
+// Configure macro-op fusion for headless frame execution (run_frame)
+// 0. Execute every instruction individually
+// 1. Execute common instruction idioms as a single superinstruction
+void config_fusion(Chip8 *emu, bool val) {
+    emu->fuse_ops = val;
+}
+
+// Configure incremental state hashing (state_hash.h)
+// 0. Don't track the state hash
+// 1. Every instruction keeps the state hash up to date
+void config_state_hash(Chip8 *emu, bool val) {
+    emu->hash_state = val;
+    if (val) {
+        state_hash_reset(emu);
+    }
+}
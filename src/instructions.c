@@ -2,7 +2,14 @@
 #include <string.h>
 
 #include "chip8.h"
+#include "debugger.h"
 #include "instructions.h"
+#include "state_hash.h"
+
+static void write_reg(Chip8*, int, unsigned _BitInt(8));
+static void write_index(Chip8*, unsigned _BitInt(16));
+static void write_mem(Chip8*, int, unsigned _BitInt(8));
+static void write_row(Chip8*, int, unsigned _BitInt(64));
 
 ////////////////////////////////////////////////////////////
 //                         Display                        //
@@ -10,6 +17,19 @@
 
 // 00E0 : Clear Screen - sets all display bits to 0
 void disp_clear(Chip8 *emu) {
+    if (emu->debug_armed) {
+        for (int i=0; i<32; i++) {
+            if (emu->display[i] != 0) {
+                debugger_watch_row(emu, i);
+            }
+        }
+    }
+    if (emu->hash_state) {
+        for (int i=0; i<32; i++) {
+            write_row(emu, i, 0);
+        }
+        return;
+    }
     memset(emu->display, 0, 32*sizeof(unsigned _BitInt(64)));
 }
 
@@ -17,16 +37,23 @@ void disp_clear(Chip8 *emu) {
 // x - register number that holds the X coordinate
 // y - register number that holds the Y coordinate
 // n - number of rows the sprite takes up (1 to 16 rows, represented with 0-15)
-void draw(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y, unsigned _BitInt(4) n) {
+// rows past the bottom of the screen are clipped
+// return 0 - successful completion
+// return 1 - sprite runs past the end of memory
+int draw(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y, unsigned _BitInt(4) n) {
+    if (emu->index_register + n > 0x1000) {
+        return 1;
+    }
+
     size_t x_coord = emu->var_regs[x] & 63;
     size_t y_coord = emu->var_regs[y] & 31;
     unsigned _BitInt(64) sprite_row;
     unsigned _BitInt(64) or;
 
     // initialize flag reg VF to 0
-    emu->var_regs[15] = 0;
+    int flag = 0;
 
-    for (size_t i=0; i<n; i++) {
+    for (size_t i=0; i<n && y_coord+i<32; i++) {
         sprite_row = emu->memory[emu->index_register+i];
         int shift = 56 - x_coord;
         if (shift >= 0) {
@@ -37,11 +64,16 @@ void draw(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y, unsigned _Bi
         
         // apply changes, flag VF=1 if collision
         or = emu->display[y_coord+i] | sprite_row;
-        emu->display[y_coord+i] ^= sprite_row;
+        write_row(emu, y_coord+i, emu->display[y_coord+i] ^ sprite_row);
         if (emu->display[y_coord+i] != or) {
-            emu->var_regs[15] = 1;
+            flag = 1;
+        }
+        if (emu->debug_armed && sprite_row != 0) {
+            debugger_watch_row(emu, y_coord+i);
         }
     }
+    write_reg(emu, 15, flag);
+    return 0;
 }
 
 
@@ -73,6 +105,11 @@ int subroutine_call(Chip8 *emu, unsigned _BitInt(12) n) {
         return 1; // stack overflow
     }
 
+    if (emu->hash_state) {
+        int top = emu->stack_top + 1;
+        emu->state_hash ^= zkey(HASH_STACK + top, emu->program_counter)
+                         ^ zkey(HASH_SP, emu->stack_top) ^ zkey(HASH_SP, top);
+    }
     emu->stack[++emu->stack_top] = emu->program_counter;
     emu->program_counter = n;
     return 0;
@@ -87,6 +124,10 @@ int subroutine_return(Chip8 *emu) {
         return 1;
     }
 
+    if (emu->hash_state) {
+        emu->state_hash ^= zkey(HASH_STACK + emu->stack_top, emu->stack[emu->stack_top])
+                         ^ zkey(HASH_SP, emu->stack_top) ^ zkey(HASH_SP, emu->stack_top - 1);
+    }
     emu->program_counter = emu->stack[emu->stack_top--];
     return 0;
 }
@@ -145,14 +186,14 @@ void skip_not_equal(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
 // x - register to set
 // n - value to set the register to
 void set_const(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(8) n) {
-    emu->var_regs[x] = n;
+    write_reg(emu, x, n);
 }
 
 // 7XNN : Add (constant)
 // x - register to add to
 // n - value to add to the register
 void add_const(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(8) n) {
-    emu->var_regs[x] += n;
+    write_reg(emu, x, emu->var_regs[x] + n);
 }
 
 
@@ -164,7 +205,7 @@ void add_const(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(8) n) {
 // x - register number for Vx
 // y - register number for Vy
 void set(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
-    emu->var_regs[x] = emu->var_regs[y];
+    write_reg(emu, x, emu->var_regs[y]);
 }
 
 
@@ -174,37 +215,37 @@ void set(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
 
 // 8XY1
 void bitwise_or(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
-    emu->var_regs[x] |= emu->var_regs[y];
+    write_reg(emu, x, emu->var_regs[x] | emu->var_regs[y]);
 }
 
 // 8XY2
 void bitwise_and(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
-    emu->var_regs[x] &= emu->var_regs[y];
+    write_reg(emu, x, emu->var_regs[x] & emu->var_regs[y]);
 }
 
 // 8XY3
 void bitwise_xor(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
-    emu->var_regs[x] ^= emu->var_regs[y];
+    write_reg(emu, x, emu->var_regs[x] ^ emu->var_regs[y]);
 }
 
 // 8XY6
 void bitwise_shift_right(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
     if (emu->shift_use_vy) {
-        emu->var_regs[x] = emu->var_regs[y];
+        write_reg(emu, x, emu->var_regs[y]);
     }
     unsigned _BitInt(4) flag = emu->var_regs[x] & 0x01;
-    emu->var_regs[x] >>= 1;
-    emu->var_regs[0xF] = flag;
+    write_reg(emu, x, emu->var_regs[x] >> 1);
+    write_reg(emu, 0xF, flag);
 }
 
 // 8XYE
 void bitwise_shift_left(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
     if (emu->shift_use_vy) {
-        emu->var_regs[x] = emu->var_regs[y];
+        write_reg(emu, x, emu->var_regs[y]);
     }
     unsigned _BitInt(4) flag = (emu->var_regs[x] & 0x80) >> 7;
-    emu->var_regs[x] <<= 1;
-    emu->var_regs[0xF] = flag;
+    write_reg(emu, x, emu->var_regs[x] << 1);
+    write_reg(emu, 0xF, flag);
 }
 
 
@@ -217,14 +258,14 @@ void add(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
     int test1 = emu->var_regs[x];
     int test2 = emu->var_regs[y];
 
-    emu->var_regs[x] += emu->var_regs[y];
+    write_reg(emu, x, emu->var_regs[x] + emu->var_regs[y]);
 
     // mark VF=1 if overflow occurred
     int flag = 0;
     if (emu->var_regs[x] != test1 + test2) {
         flag = 1;
     }
-    emu->var_regs[0xF] = flag;
+    write_reg(emu, 0xF, flag);
 }
 
 // 8XY5
@@ -232,14 +273,14 @@ void subtract_x_y(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
     int test1 = emu->var_regs[x];
     int test2 = emu->var_regs[y];
     
-    emu->var_regs[x] -= emu->var_regs[y];
+    write_reg(emu, x, emu->var_regs[x] - emu->var_regs[y]);
 
     // mark VF=1 if no underflow occured
     int flag = 0;
     if (emu->var_regs[x] == test1 - test2) {
         flag = 1;
     }
-    emu->var_regs[0xF] = flag;
+    write_reg(emu, 0xF, flag);
 }
 
 // 8XY7
@@ -247,14 +288,14 @@ void subtract_y_x(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
     int test1 = emu->var_regs[x];
     int test2 = emu->var_regs[y];
     
-    emu->var_regs[x] = emu->var_regs[y] - emu->var_regs[x];
+    write_reg(emu, x, emu->var_regs[y] - emu->var_regs[x]);
 
     // mark VF=1 if no underflow occured
     int flag = 0;
     if (emu->var_regs[x] == test2 - test1) {
         flag = 1;
     }
-    emu->var_regs[0xF] = flag;
+    write_reg(emu, 0xF, flag);
 }
 
 ////////////////////////////////////////////////////////////
@@ -264,37 +305,52 @@ void subtract_y_x(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(4) y) {
 // ANNN : Set index register
 // n - value index register will be set to
 void set_index(Chip8 *emu, unsigned _BitInt(12) n) {
-    emu->index_register = n;
+    write_index(emu, n);
 }
 
 // FX1E : Add Vx to I - VF not affected
 void add_index(Chip8 *emu, unsigned _BitInt(4) x) {
-    emu->index_register += emu->var_regs[x];
+    write_index(emu, emu->index_register + emu->var_regs[x]);
 }
 
 // FX29 : Set index register to memory location for sprite character that represents value in Vx
 void sprite_index(Chip8 *emu, unsigned _BitInt(4) x) {
-    emu->index_register = 0x050 + (emu->var_regs[x] * 5);
+    write_index(emu, 0x050 + (emu->var_regs[x] * 5));
 }
 
 // FX55 : register dump V0-Vx into memory, starting at location I
-void reg_dump(Chip8 *emu, unsigned _BitInt(4) x) {
+// return 0 - successful completion
+// return 1 - I + x past the end of memory
+int reg_dump(Chip8 *emu, unsigned _BitInt(4) x) {
+    if (emu->index_register + x > 0xFFF) {
+        return 1;
+    }
     for (int i=0; i<=x; i++) {
-        emu->memory[emu->index_register+i] = emu->var_regs[i];
+        write_mem(emu, emu->index_register+i, emu->var_regs[i]);
+        if (emu->debug_armed) {
+            debugger_watch_mem(emu, emu->index_register+i);
+        }
     }
     if (emu->store_load_i_inc) {
-        emu->index_register += x + 1;
+        write_index(emu, emu->index_register + x + 1);
     }
+    return 0;
 }
 
 // FX65 : register load V0-Vx from memory, starting at location I
-void reg_load(Chip8 *emu, unsigned _BitInt(4) x) {
+// return 0 - successful completion
+// return 1 - I + x past the end of memory
+int reg_load(Chip8 *emu, unsigned _BitInt(4) x) {
+    if (emu->index_register + x > 0xFFF) {
+        return 1;
+    }
     for (int i=0; i<=x; i++) {
-        emu->var_regs[i] = emu->memory[emu->index_register+i];
+        write_reg(emu, i, emu->memory[emu->index_register+i]);
     }
     if (emu->store_load_i_inc) {
-        emu->index_register += x + 1;
+        write_index(emu, emu->index_register + x + 1);
     }
+    return 0;
 }
 
 ////////////////////////////////////////////////////////////
@@ -302,8 +358,17 @@ void reg_load(Chip8 *emu, unsigned _BitInt(4) x) {
 ////////////////////////////////////////////////////////////
 
 // CXNN : Random
+// xorshift32 on the emulator's own state so snapshots replay identically
 void gen_rand(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(8) n) {
-    emu->var_regs[x] = rand() & n;
+    unsigned _BitInt(32) r = emu->rng_state;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    if (emu->hash_state) {
+        emu->state_hash ^= zkey(HASH_RNG, emu->rng_state) ^ zkey(HASH_RNG, r);
+    }
+    emu->rng_state = r;
+    write_reg(emu, x, r & n);
 }
 
 
@@ -311,11 +376,34 @@ void gen_rand(Chip8 *emu, unsigned _BitInt(4) x, unsigned _BitInt(8) n) {
 //                          KeyOp                         //
 ////////////////////////////////////////////////////////////
 
-// EX9E : Skip if key currently pressed == Vx
+// EX9E : Skip if key Vx (lowest four bits) is pressed
+void skip_key_pressed(Chip8 *emu, unsigned _BitInt(4) x) {
+    if ((emu->keys >> (emu->var_regs[x] & 0xF)) & 1) {
+        emu->program_counter += 2;
+    }
+}
 
-// EXA1 : Skip if key currently pressed != Vx
+// EXA1 : Skip if key Vx (lowest four bits) is not pressed
+void skip_key_not_pressed(Chip8 *emu, unsigned _BitInt(4) x) {
+    if (!((emu->keys >> (emu->var_regs[x] & 0xF)) & 1)) {
+        emu->program_counter += 2;
+    }
+}
 
 // FX0A : Await input, grab & store key pressed
+// repeats this instruction until a key is down, stores the lowest key pressed
+void await_key(Chip8 *emu, unsigned _BitInt(4) x) {
+    if (emu->keys == 0) {
+        emu->program_counter -= 2;
+        return;
+    }
+    for (int i=0; i<16; i++) {
+        if ((emu->keys >> i) & 1) {
+            write_reg(emu, x, i);
+            return;
+        }
+    }
+}
 
 ////////////////////////////////////////////////////////////
 //                          Timer                         //
@@ -328,7 +416,7 @@ void delay_timer(Chip8 *emu, unsigned _BitInt(4) x) {
 
 // FX07 : Get delay timer
 void get_delay(Chip8 *emu, unsigned _BitInt(4) x) {
-    emu->var_regs[x] = emu->delay_timer;
+    write_reg(emu, x, emu->delay_timer);
 }
 
 ////////////////////////////////////////////////////////////
@@ -346,8 +434,54 @@ void sound_timer(Chip8 *emu, unsigned _BitInt(4) x) {
 ////////////////////////////////////////////////////////////
 
 // FX33 : Binary-coded decimal conversion
-void bcd(Chip8 *emu, unsigned _BitInt(4) x) {
-    emu->memory[emu->index_register]   = emu->var_regs[x] / 100;
-    emu->memory[emu->index_register+1] = (emu->var_regs[x] % 100) / 10;
-    emu->memory[emu->index_register+2] = emu->var_regs[x] % 10;
-}
\ No newline at end of file
+// return 0 - successful completion
+// return 1 - I + 2 past the end of memory
+int bcd(Chip8 *emu, unsigned _BitInt(4) x) {
+    if (emu->index_register + 2 > 0xFFF) {
+        return 1;
+    }
+    write_mem(emu, emu->index_register,   emu->var_regs[x] / 100);
+    write_mem(emu, emu->index_register+1, (emu->var_regs[x] % 100) / 10);
+    write_mem(emu, emu->index_register+2, emu->var_regs[x] % 10);
+    if (emu->debug_armed) {
+        for (int i=0; i<3; i++) {
+            debugger_watch_mem(emu, emu->index_register+i);
+        }
+    }
+    return 0;
+}
+
+
+////////////////////////////////////////////////////////////
+//                       State Hash                       //
+////////////////////////////////////////////////////////////
+
+// writes to hashed state (state_hash.h), keep the zobrist hash in step while enabled
+
+static void write_reg(Chip8 *emu, int x, unsigned _BitInt(8) val) {
+    if (emu->hash_state) {
+        emu->state_hash ^= zkey(HASH_V0 + x, emu->var_regs[x]) ^ zkey(HASH_V0 + x, val);
+    }
+    emu->var_regs[x] = val;
+}
+
+static void write_index(Chip8 *emu, unsigned _BitInt(16) val) {
+    if (emu->hash_state) {
+        emu->state_hash ^= zkey(HASH_I, emu->index_register) ^ zkey(HASH_I, val);
+    }
+    emu->index_register = val;
+}
+
+static void write_mem(Chip8 *emu, int addr, unsigned _BitInt(8) val) {
+    if (emu->hash_state) {
+        emu->state_hash ^= zkey(HASH_MEM + addr, emu->memory[addr]) ^ zkey(HASH_MEM + addr, val);
+    }
+    emu->memory[addr] = val;
+}
+
+static void write_row(Chip8 *emu, int row, unsigned _BitInt(64) val) {
+    if (emu->hash_state) {
+        emu->state_hash ^= zkey(HASH_ROW + row, emu->display[row]) ^ zkey(HASH_ROW + row, val);
+    }
+    emu->display[row] = val;
+}
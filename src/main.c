@@ -1,39 +1,75 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <time.h>
 
 #include <ncurses.h>
 #include <unistd.h>
 
 #include "chip8.h"
+#include "cpu.h"
+#include "debugger.h"
 #include "init.h"
-#include "instructions.h"
+#include "shm_export.h"
 #include "term_disp.h"
 
-// instruction decode macros
-#define OP(ins) ((ins & 0xF000) >> 12)
-#define X(ins) ((ins & 0x0F00) >> 8)
-#define Y(ins) ((ins & 0x00F0) >> 4)
-#define N(ins) (ins & 0x000F)
-#define NN(ins) (ins & 0x00FF)
-#define NNN(ins) (ins & 0x0FFF)
-
 typedef struct timespec timespec;
 
+// run loop options
+static bool headless = false;           // -H : no terminal display / input
+static ShmFrame *shm_frame = NULL;      // -s : publish frames to shared memory
+
+// SIGINT / SIGTERM - leave the run loop so the terminal & shm segment get cleaned up
+static volatile sig_atomic_t stop_requested = 0;
+static void request_stop(int sig) {
+    stop_requested = sig;
+}
+
 int fetch_decode_execute(Chip8*);
+int run_ahead_loop(Chip8*, int);
 void timespec_sum(timespec*, timespec*, timespec*);
 bool timespec_less(timespec*, timespec*);
 
 int main(int argc, char ** argv) {
+    // options
+    // -d path : attach debugger, "-" for stdin or a UNIX socket path
+    // -r N    : run N frames ahead of the displayed frame to hide input latency
+    // -s name : publish display, timers & frame counter to POSIX shm "name"
+    // -H      : headless, no terminal display (use with -s)
+    char *debug_path = NULL;
+    char *shm_name = NULL;
+    int run_ahead = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:r:s:H")) != -1) {
+        switch (opt) {
+        case 'd':
+            debug_path = optarg;
+            break;
+        case 'r':
+            run_ahead = atoi(optarg);
+            break;
+        case 's':
+            shm_name = optarg;
+            break;
+        case 'H':
+            headless = true;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
     // check if file arg is present
-    if (argc != 2) {
-        printf("Usage: chip8emu /path/to/rom\n");
+    if (optind != argc - 1 || run_ahead < 0 || (run_ahead > 0 && debug_path != NULL)) {
+        printf("Usage: chip8emu [-d debug_socket|-] [-r frames] [-s shm_name] [-H] /path/to/rom\n");
+        printf("       -d and -r can't be combined\n");
         return EXIT_FAILURE;
     }
 
     // open rom file
-    int rom = open(argv[1], O_RDWR);
+    int rom = open(argv[optind], O_RDWR);
     if (rom == -1) {
         printf("ERROR: Incorrect file path\n");
         return EXIT_FAILURE;    
@@ -41,15 +77,43 @@ int main(int argc, char ** argv) {
     
     // initialize chip 8 emulator
     Chip8 *emu = new_chip8(rom);
+    config_quirk_analysis(emu, lseek(rom, 0, SEEK_END));
+
+    // attach debugger before the terminal display takes over the screen
+    if (debug_path != NULL && debugger_attach(emu, debug_path)) {
+        printf("ERROR: Could not open debugger on %s\n", debug_path);
+        free(emu);
+        return EXIT_FAILURE;
+    }
     
+    // shared memory export for external viewers
+    if (shm_name != NULL && (shm_frame = shm_export_open(shm_name)) == NULL) {
+        printf("ERROR: Could not create shared memory %s\n", shm_name);
+        debugger_detach(emu);
+        free(emu);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, request_stop);
+    signal(SIGTERM, request_stop);
+
     // initialize terminal display
-    term_disp_init();
+    if (!headless) {
+        term_disp_init();
+    }
     
     // main fetch / decode / execute loop
-    int rtn = fetch_decode_execute(emu);
+    int rtn = run_ahead > 0 ? run_ahead_loop(emu, run_ahead)
+                            : fetch_decode_execute(emu);
 
     // stop terminal display, free memory allocated for emulator
-    term_disp_end();
+    if (!headless) {
+        term_disp_end();
+    }
+    if (shm_frame != NULL) {
+        shm_export_close(shm_frame, shm_name);
+    }
+    debugger_detach(emu);
     free(emu);
 
     // check if error occured during fetch / decode / execute
@@ -80,151 +144,21 @@ int fetch_decode_execute(Chip8 *emu) {
     int disp_x, disp_y;
 
     while (emu->program_counter < 0xFFF) {
-        // FETCH
-        unsigned _BitInt(16) curr_ins
-            = emu->memory[emu->program_counter] * 0x100
-            + emu->memory[emu->program_counter + 1];
-        emu->program_counter += 2;
-        
-        // DECODE & EXECUTE
-        switch (OP(curr_ins)) {
-        case 0x0:
-            switch (NNN(curr_ins)) {
-            case 0x0E0: // 00E0
-                disp_clear(emu);
-                //print_display_full(emu);
-                break;
-
-            case 0x0EE: // 00EE
-                subroutine_return(emu);
+        // stop for debugger (only checked while breakpoints / watchpoints are set)
+        if (emu->debug_armed && debugger_check(emu)) {
+            if (debugger_prompt(emu)) {
                 break;
             }
-            break;
-
-        case 0x1: // 1NNN
-            jump(emu, NNN(curr_ins));
-            break;
-
-        case 0x2: // 2NNN
-            subroutine_call(emu, NNN(curr_ins));
-            break;
-
-        case 0x3: // 3XNN
-            skip_equal_const(emu, X(curr_ins), NN(curr_ins));
-            break;
-
-        case 0x4: // 4XNN
-            skip_not_equal_const(emu, X(curr_ins), NN(curr_ins));
-            break;
-
-        case 0x5: // 5XY0
-            skip_equal(emu, X(curr_ins), Y(curr_ins));
-            break;
-
-        case 0x6: // 6XNN
-            set_const(emu, X(curr_ins), NN(curr_ins));
-            break;
-
-        case 0x7: // 7XNN
-            add_const(emu, X(curr_ins), NN(curr_ins));
-            break;
-
-        case 0x8:
-            switch (N(curr_ins)) {
-            case 0x0: // 8XY0
-                set(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x1: // 8XY1
-                bitwise_or(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x2: // 8XY2
-                bitwise_and(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x3: // 8XY3
-                bitwise_xor(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x4: // 8XY4
-                add(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x5: // 8XY5
-                subtract_x_y(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x6: // 8XY6
-                bitwise_shift_right(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0x7: // 8XY7
-                subtract_y_x(emu, X(curr_ins), Y(curr_ins));
-                break;
-            case 0xE: // 8XYE
-                bitwise_shift_left(emu, X(curr_ins), Y(curr_ins));
-                break;
-            }
-            break;
 
-        case 0x9: // 9XY0
-            skip_not_equal(emu, X(curr_ins), Y(curr_ins));
-            break;
-
-        case 0xA: // ANNN
-            set_index(emu, NNN(curr_ins));
-            break;
-
-        case 0xB: // BNNN
-            jump_offset(emu, NNN(curr_ins));
-            break;
-
-        case 0xC: // CXNN
-            gen_rand(emu, X(curr_ins), NN(curr_ins));
-            break;
-
-        case 0xD: // DXYN
-            draw(emu, X(curr_ins), Y(curr_ins), N(curr_ins));
-            break;
-
-        case 0xE:
-            switch (NN(curr_ins)) {
-            case 0x9E: // EX9E
-                // skip if key pressed == Vx (lowest four bits)
-                break;
-            case 0xA1: // EXA1
-                // skip if key pressed != Vx (lowest four bits)
-                break;
-            }
-            break;
-
-        case 0xF:
-            switch (NN(curr_ins)) {
-            case 0x07: // FX07
-                get_delay(emu, X(curr_ins));
-                break;
-            case 0x0A: // FX0A
-                 // key op get key
-                break;
-            case 0x15: // FX15
-                delay_timer(emu, X(curr_ins));
-                break;
-            case 0x18: // FX18
-                sound_timer(emu, X(curr_ins));
-                break;
-            case 0x1E: // FX1E
-                add_index(emu, X(curr_ins));
-                break;
-            case 0x29: // FX29
-                sprite_index(emu, X(curr_ins));
-                break;
-            case 0x33: // FX33
-                bcd(emu, X(curr_ins));
-                break;
-            case 0x55: // FX55
-                reg_dump(emu, X(curr_ins));
-                break;
-            case 0x65: // FX65
-                reg_load(emu, X(curr_ins));
-                break;
-            }
-            break;
+            // don't try to catch up on the time spent stopped
+            clock_gettime(CLOCK_MONOTONIC, &curr_time);
+            timespec_sum(&curr_time, &inst_cycle_time, &inst_cycle_next);
+            timespec_sum(&curr_time, &cycle_60hz_time, &cycle_60hz_next);
         }
 
+        // FETCH / DECODE / EXECUTE
+        execute_instruction(emu);
+
         // busy loop awaiting instruction cycle to end
         // take advantage of busy loop time to check on timers
         // with longer cycles...
@@ -240,21 +174,35 @@ int fetch_decode_execute(Chip8 *emu) {
 
             // process end of 60hz cycle
             if (!timespec_less(&curr_time, &cycle_60hz_next)) {
-                // display
-                term_disp_print(emu, &disp_y, &disp_x);
-
-                // decrement sound timer if above 0
-                if (emu->sound_timer > 0) {
-                    emu->sound_timer--;
+                if (!headless) {
+                    // input (stdin belongs to the debugger when it's reading from it)
+                    if (emu->debugger == NULL || emu->debugger->in_fd != STDIN_FILENO) {
+                        term_disp_keys(emu);
+                    }
+
+                    // display
+                    term_disp_print(emu, &disp_y, &disp_x);
                 }
 
-                // decrement delay timer if above 0
-                if (emu->delay_timer > 0) {
-                    emu->delay_timer--;
+                // decrement sound & delay timers
+                tick_timers(emu);
+
+                // external viewers
+                if (shm_frame != NULL) {
+                    shm_export_publish(shm_frame, emu);
                 }
 
                 // set 60hz cycle timers for the next 60hz cycle
                 timespec_sum(&cycle_60hz_next, &cycle_60hz_time, &cycle_60hz_next);
+
+                // debugger commands sent while running
+                if (emu->debugger != NULL && debugger_poll(emu)) {
+                    return 0;
+                }
+
+                if (stop_requested) {
+                    return 0;
+                }
             }
         }
     }
@@ -262,6 +210,49 @@ int fetch_decode_execute(Chip8 *emu) {
     return 0;
 }
 
+// frame-paced loop with run-ahead
+// each 60hz frame: run the real frame with the current input, snapshot it,
+// run `frames` more frames on the snapshot with the same input and display
+// that, then drop the snapshot (the real state was never touched)
+// return codes: same as fetch_decode_execute
+int run_ahead_loop(Chip8 *emu, int frames) {
+    timespec cycle_60hz_time = {0, 1000000000 / 60};
+    timespec cycle_60hz_next, curr_time;
+    clock_gettime(CLOCK_MONOTONIC, &cycle_60hz_next);
+
+    Chip8 *ahead = (Chip8*)malloc(sizeof(Chip8));
+    int disp_x, disp_y;
+
+    while (emu->program_counter < 0xFFF && !stop_requested) {
+        if (!headless) {
+            term_disp_keys(emu);
+        }
+        run_frame(emu);
+        if (shm_frame != NULL) {
+            shm_export_publish(shm_frame, emu);
+        }
+
+        snapshot_chip8(emu, ahead);
+        for (int i=0; i<frames && ahead->program_counter < 0xFFF; i++) {
+            run_frame(ahead);
+        }
+        if (!headless) {
+            term_disp_print(ahead, &disp_y, &disp_x);
+        }
+
+        // sleep until the next frame, don't try to catch up on missed frames
+        timespec_sum(&cycle_60hz_next, &cycle_60hz_time, &cycle_60hz_next);
+        clock_gettime(CLOCK_MONOTONIC, &curr_time);
+        if (timespec_less(&cycle_60hz_next, &curr_time)) {
+            cycle_60hz_next = curr_time;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &cycle_60hz_next, NULL);
+    }
+
+    free(ahead);
+    return 0;
+}
+
 // Take sum of time1 and time2 and place result into sum
 void timespec_sum(timespec *time1, timespec *time2, timespec *sum) {
     // add sec and nsec from both times
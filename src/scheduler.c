@@ -0,0 +1,271 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "scheduler.h"
+
+// event driven scheduler - each worker thread owns many instances in a timer
+// wheel keyed by their next frame deadline, runs every due instance's frame
+// and sleeps until the next occupied slot (or until woken by add / remove / stop)
+// other threads only reach an instance through its worker's lock
+
+static void *worker_main(void*);
+static void wheel_insert(SchedWorker*, SchedInstance*);
+static void take_handovers(SchedWorker*);
+
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////
+//                     Create / Stop                      //
+////////////////////////////////////////////////////////////
+
+// start worker threads (usually one per core)
+Scheduler* scheduler_new(int workers) {
+    Scheduler *sched = (Scheduler*)calloc(1, sizeof(Scheduler));
+    sched->worker_count = workers < 1 ? 1 : workers;
+    sched->workers = (SchedWorker*)calloc(sched->worker_count, sizeof(SchedWorker));
+
+    // deadlines are CLOCK_MONOTONIC, sleeps have to be too
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    long long start = now_ns();
+    for (int i=0; i<sched->worker_count; i++) {
+        SchedWorker *w = &sched->workers[i];
+        w->sched = sched;
+        w->wheel_time = start - start % WHEEL_SLOT_NS;
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->wake, &attr);
+        pthread_cond_init(&w->done, NULL);
+        pthread_create(&w->thread, NULL, worker_main, w);
+    }
+    pthread_condattr_destroy(&attr);
+    return sched;
+}
+
+// hand an instance to the least loaded worker
+// first frames are spread over the frame period so instances don't all wake together
+// return handle for scheduler_remove / scheduler_set_keys
+SchedInstance* scheduler_add(Scheduler *sched, Chip8 *emu) {
+    SchedWorker *w = &sched->workers[0];
+    for (int i=1; i<sched->worker_count; i++) {
+        if (atomic_load(&sched->workers[i].count) < atomic_load(&w->count)) {
+            w = &sched->workers[i];
+        }
+    }
+
+    unsigned long n = atomic_fetch_add(&sched->added, 1);
+    SchedInstance *inst = (SchedInstance*)calloc(1, sizeof(SchedInstance));
+    inst->emu = emu;
+    inst->worker = w;
+    inst->deadline = (long long)((n * 0x9E3779B9UL) % FRAME_NS); // made absolute by the worker
+
+    pthread_mutex_lock(&w->lock);
+    inst->next = w->inbox;
+    w->inbox = inst;
+    atomic_fetch_add(&w->count, 1);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    return inst;
+}
+
+// take an instance off its worker, blocks until the worker lets go of it
+// the emulator is the caller's again afterwards, the handle is freed
+// (only while the scheduler is running, scheduler_free cleans up after stop)
+void scheduler_remove(Scheduler *sched, SchedInstance *inst) {
+    (void)sched;
+    SchedWorker *w = inst->worker;
+
+    pthread_mutex_lock(&w->lock);
+    inst->removing = true;
+    w->removals++;
+    pthread_cond_signal(&w->wake);
+    while (!inst->removed) {
+        pthread_cond_wait(&w->done, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+    free(inst);
+}
+
+// keypad state for an instance, applied by its worker before the next frame
+void scheduler_set_keys(Scheduler *sched, SchedInstance *inst, unsigned _BitInt(16) keys) {
+    (void)sched;
+    SchedWorker *w = inst->worker;
+
+    pthread_mutex_lock(&w->lock);
+    inst->keys = keys;
+    if (!inst->input_pending) {
+        inst->input_pending = true;
+        inst->next_input = w->inputs;
+        w->inputs = inst;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+// stop & join all workers (instances stay owned by the caller)
+void scheduler_stop(Scheduler *sched) {
+    atomic_store(&sched->stopping, true);
+    for (int i=0; i<sched->worker_count; i++) {
+        SchedWorker *w = &sched->workers[i];
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_signal(&w->wake);
+        pthread_mutex_unlock(&w->lock);
+    }
+    for (int i=0; i<sched->worker_count; i++) {
+        pthread_join(sched->workers[i].thread, NULL);
+    }
+}
+
+// free scheduler bookkeeping after scheduler_stop
+void scheduler_free(Scheduler *sched) {
+    for (int i=0; i<sched->worker_count; i++) {
+        SchedWorker *w = &sched->workers[i];
+        SchedInstance *lists[WHEEL_SLOTS + 1];
+        memcpy(lists, w->wheel, sizeof(w->wheel));
+        lists[WHEEL_SLOTS] = w->inbox;
+        for (int s=0; s<=WHEEL_SLOTS; s++) {
+            while (lists[s] != NULL) {
+                SchedInstance *next = lists[s]->next;
+                free(lists[s]);
+                lists[s] = next;
+            }
+        }
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->wake);
+        pthread_mutex_destroy(&w->lock);
+    }
+    free(sched->workers);
+    free(sched);
+}
+
+
+////////////////////////////////////////////////////////////
+//                         Worker                         //
+////////////////////////////////////////////////////////////
+
+// slot for a deadline, deadlines already passed go in the next slot to run
+static void wheel_insert(SchedWorker *w, SchedInstance *inst) {
+    long long t = inst->deadline < w->wheel_time ? w->wheel_time : inst->deadline;
+    int slot = (t / WHEEL_SLOT_NS) % WHEEL_SLOTS;
+    inst->next = w->wheel[slot];
+    w->wheel[slot] = inst;
+}
+
+// under the worker's lock - take new instances, apply input, let go of removed instances
+static void take_handovers(SchedWorker *w) {
+    // first frame counts from when the worker picks an instance up
+    long long picked_up = now_ns();
+    SchedInstance *inbox = w->inbox;
+    w->inbox = NULL;
+    while (inbox != NULL) {
+        SchedInstance *next = inbox->next;
+        inbox->deadline += picked_up;
+        wheel_insert(w, inbox);
+        inbox = next;
+    }
+
+    for (SchedInstance *inst=w->inputs; inst!=NULL; inst=inst->next_input) {
+        inst->emu->keys = inst->keys;
+        inst->input_pending = false;
+    }
+    w->inputs = NULL;
+
+    if (w->removals > 0) {
+        for (int s=0; s<WHEEL_SLOTS; s++) {
+            SchedInstance **link = &w->wheel[s];
+            while (*link != NULL) {
+                SchedInstance *inst = *link;
+                if (inst->removing) {
+                    *link = inst->next;
+                    inst->removed = true;
+                    atomic_fetch_sub(&w->count, 1);
+                } else {
+                    link = &inst->next;
+                }
+            }
+        }
+        w->removals = 0;
+        pthread_cond_broadcast(&w->done);
+    }
+}
+
+static void *worker_main(void *arg) {
+    SchedWorker *w = (SchedWorker*)arg;
+
+    while (!atomic_load(&w->sched->stopping)) {
+        pthread_mutex_lock(&w->lock);
+        take_handovers(w);
+        pthread_mutex_unlock(&w->lock);
+
+        // run every slot that had started at the top of this pass
+        // (re-reading the clock here would never return to the inbox / stop
+        // check while overloaded)
+        long long now = now_ns();
+        while (w->wheel_time <= now) {
+            long long slot_end = w->wheel_time + WHEEL_SLOT_NS;
+            int slot = (w->wheel_time / WHEEL_SLOT_NS) % WHEEL_SLOTS;
+            SchedInstance *due = w->wheel[slot];
+            w->wheel[slot] = NULL;
+            w->wheel_time = slot_end;
+
+            while (due != NULL) {
+                SchedInstance *inst = due;
+                due = due->next;
+
+                // still a wheel rotation away
+                if (inst->deadline >= slot_end) {
+                    wheel_insert(w, inst);
+                    continue;
+                }
+
+                long long late = now_ns() - inst->deadline;
+                int bucket = late < 0 ? 0 : late / LATE_BUCKET_NS;
+                w->late[bucket < LATE_BUCKETS ? bucket : LATE_BUCKETS - 1]++;
+
+                run_frame(inst->emu);
+                w->frames++;
+
+                // fell a whole frame behind - drop it rather than bursting to catch up
+                inst->deadline += FRAME_NS;
+                if (inst->deadline + FRAME_NS <= now) {
+                    long long behind = (now - inst->deadline) / FRAME_NS;
+                    inst->deadline += behind * FRAME_NS;
+                    w->dropped += behind;
+                }
+                wheel_insert(w, inst);
+            }
+        }
+
+        // sleep until the next occupied slot (at most one wheel rotation),
+        // or until there's an instance, a removal or stop to handle
+        long long wake = w->wheel_time;
+        for (int i=0; i<WHEEL_SLOTS; i++) {
+            if (w->wheel[(wake / WHEEL_SLOT_NS) % WHEEL_SLOTS] != NULL) {
+                break;
+            }
+            wake += WHEEL_SLOT_NS;
+        }
+        struct timespec ts = { wake / 1000000000, wake % 1000000000 };
+        pthread_mutex_lock(&w->lock);
+        while (w->inbox == NULL && w->removals == 0 && !atomic_load(&w->sched->stopping)) {
+            if (pthread_cond_timedwait(&w->wake, &w->lock, &ts) == ETIMEDOUT) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+
+    // release anything removed while stopping
+    pthread_mutex_lock(&w->lock);
+    take_handovers(w);
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
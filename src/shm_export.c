@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "chip8.h"
+#include "shm_export.h"
+
+// POSIX shm names need a leading '/'
+static void shm_name(const char *name, char *out, size_t len) {
+    snprintf(out, len, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+////////////////////////////////////////////////////////////
+//                         Writer                         //
+////////////////////////////////////////////////////////////
+
+// create (or reuse) the named segment and map it
+// return NULL if the segment can't be created
+ShmFrame* shm_export_open(const char *name) {
+    char path[256];
+    shm_name(name, path, sizeof(path));
+
+    int fd = shm_open(path, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(ShmFrame)) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    ShmFrame *frame = mmap(NULL, sizeof(ShmFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (frame == MAP_FAILED) {
+        return NULL;
+    }
+
+    memset(frame, 0, sizeof(ShmFrame));
+    return frame;
+}
+
+// publish display, timers & frame counter (end of each 60hz cycle)
+// never waits on readers
+void shm_export_publish(ShmFrame *frame, Chip8 *emu) {
+    unsigned int seq = atomic_load_explicit(&frame->seq, memory_order_relaxed);
+    atomic_store_explicit(&frame->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (int i=0; i<32; i++) {
+        frame->display[i] = emu->display[i];
+    }
+    frame->frame_count = emu->frame_count;
+    frame->delay_timer = emu->delay_timer;
+    frame->sound_timer = emu->sound_timer;
+
+    atomic_store_explicit(&frame->seq, seq + 2, memory_order_release);
+}
+
+// unmap & remove the segment
+void shm_export_close(ShmFrame *frame, const char *name) {
+    char path[256];
+    shm_name(name, path, sizeof(path));
+
+    munmap(frame, sizeof(ShmFrame));
+    shm_unlink(path);
+}
+
+
+////////////////////////////////////////////////////////////
+//                         Reader                         //
+////////////////////////////////////////////////////////////
+
+// map an existing segment read-only
+// return NULL if no emulator is exporting under that name
+ShmFrame* shm_view_open(const char *name) {
+    char path[256];
+    shm_name(name, path, sizeof(path));
+
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    ShmFrame *frame = mmap(NULL, sizeof(ShmFrame), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return frame == MAP_FAILED ? NULL : frame;
+}
+
+// copy a consistent frame into emu (display, timers & frame counter)
+void shm_view_read(ShmFrame *frame, Chip8 *emu) {
+    unsigned long long display[32];
+    unsigned long long frame_count;
+    unsigned char delay, sound;
+    unsigned int before, after;
+
+    do {
+        before = atomic_load_explicit(&frame->seq, memory_order_acquire);
+        memcpy(display, frame->display, sizeof(display));
+        frame_count = frame->frame_count;
+        delay = frame->delay_timer;
+        sound = frame->sound_timer;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&frame->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    for (int i=0; i<32; i++) {
+        emu->display[i] = display[i];
+    }
+    emu->frame_count = frame_count;
+    emu->delay_timer = delay;
+    emu->sound_timer = sound;
+}
+
+void shm_view_close(ShmFrame *frame) {
+    munmap(frame, sizeof(ShmFrame));
+}
@@ -0,0 +1,124 @@
+#include <stdlib.h>
+
+#include "chip8.h"
+#include "state_hash.h"
+
+static unsigned long long tracked_hash(Chip8*);
+static unsigned long long untracked_hash(Chip8*);
+
+////////////////////////////////////////////////////////////
+//                       State Hash                       //
+////////////////////////////////////////////////////////////
+
+// key for a slot holding a value, computed instead of tabled so 64-bit display
+// rows hash the same way as bytes (splitmix64 finalizer)
+unsigned long long zkey(int slot, unsigned long long value) {
+    unsigned long long z = value + (unsigned long long)(slot + 1) * 0x9E3779B97F4A7C15;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+// hash of the machine state, incremental (hash_state must be set)
+// keypad, frame stats & configuration aren't part of the state
+unsigned long long state_hash(Chip8 *emu) {
+    return emu->state_hash ^ untracked_hash(emu);
+}
+
+// hash of the machine state recomputed from scratch, equal to state_hash
+unsigned long long state_hash_full(Chip8 *emu) {
+    return tracked_hash(emu) ^ untracked_hash(emu);
+}
+
+// recompute the incremental hash (after writing state outside the handlers)
+void state_hash_reset(Chip8 *emu) {
+    emu->state_hash = tracked_hash(emu);
+}
+
+static unsigned long long tracked_hash(Chip8 *emu) {
+    unsigned long long hash = 0;
+    for (int i=0; i<4096; i++) {
+        hash ^= zkey(HASH_MEM + i, emu->memory[i]);
+    }
+    for (int i=0; i<16; i++) {
+        hash ^= zkey(HASH_V0 + i, emu->var_regs[i]);
+    }
+    // only the live part of the stack, stale return addresses above the top don't matter
+    for (int i=0; i<=emu->stack_top; i++) {
+        hash ^= zkey(HASH_STACK + i, emu->stack[i]);
+    }
+    for (int i=0; i<32; i++) {
+        hash ^= zkey(HASH_ROW + i, emu->display[i]);
+    }
+    hash ^= zkey(HASH_I, emu->index_register);
+    hash ^= zkey(HASH_SP, emu->stack_top);
+    hash ^= zkey(HASH_RNG, emu->rng_state);
+    return hash;
+}
+
+static unsigned long long untracked_hash(Chip8 *emu) {
+    return zkey(HASH_PC, emu->program_counter)
+         ^ zkey(HASH_DELAY, emu->delay_timer)
+         ^ zkey(HASH_SOUND, emu->sound_timer)
+         ^ zkey(HASH_FRAME, emu->frame_count % 60);
+}
+
+
+////////////////////////////////////////////////////////////
+//                        State Set                       //
+////////////////////////////////////////////////////////////
+
+// capacity - initial slots, rounded up to a power of two
+StateSet* state_set_new(size_t capacity) {
+    StateSet *set = (StateSet*)malloc(sizeof(StateSet));
+    set->capacity = 1024;
+    while (set->capacity < capacity) {
+        set->capacity *= 2;
+    }
+    set->slots = (unsigned long long*)calloc(set->capacity, sizeof(unsigned long long));
+    set->count = 0;
+    return set;
+}
+
+// add a hash (0 is stored as 1, it marks empty slots)
+// return true if it wasn't in the set
+bool state_set_insert(StateSet *set, unsigned long long hash) {
+    if (hash == 0) {
+        hash = 1;
+    }
+
+    // double at half load, reinserting everything
+    if ((set->count + 1) * 2 > set->capacity) {
+        unsigned long long *old = set->slots;
+        size_t old_capacity = set->capacity;
+        set->capacity *= 2;
+        set->slots = (unsigned long long*)calloc(set->capacity, sizeof(unsigned long long));
+        for (size_t i=0; i<old_capacity; i++) {
+            if (old[i] != 0) {
+                size_t s = old[i] & (set->capacity - 1);
+                while (set->slots[s] != 0) {
+                    s = (s + 1) & (set->capacity - 1);
+                }
+                set->slots[s] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    // linear probing, the low bits of a zobrist hash are already uniform
+    size_t s = hash & (set->capacity - 1);
+    while (set->slots[s] != 0) {
+        if (set->slots[s] == hash) {
+            return false;
+        }
+        s = (s + 1) & (set->capacity - 1);
+    }
+    set->slots[s] = hash;
+    set->count++;
+    return true;
+}
+
+void state_set_free(StateSet *set) {
+    free(set->slots);
+    free(set);
+}
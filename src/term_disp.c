@@ -1,9 +1,55 @@
 #include <locale.h>
+#include <time.h>
 #include <ncurses.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 
 #include "term_disp.h"
 #include "chip8.h"
 
+// braille dot bits for a 2x2 block of pixels
+// index = (upper row's left/right pixel << 2) | (lower row's left/right pixel)
+// braille_top    - pixel rows 0 & 1 of a cell (dots 1,4 / 2,5)
+// braille_bottom - pixel rows 2 & 3 of a cell (dots 3,6 / 7,8)
+static const unsigned _BitInt(8) braille_top[16] = {
+    0x00, 0x10, 0x02, 0x12, 0x08, 0x18, 0x0A, 0x1A,
+    0x01, 0x11, 0x03, 0x13, 0x09, 0x19, 0x0B, 0x1B
+};
+static const unsigned _BitInt(8) braille_bottom[16] = {
+    0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0,
+    0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4
+};
+
+// frame skipping under output backpressure (slow links / ssh)
+// a frame is skipped when the tty output queue still holds earlier frames'
+// output when it starts, or the last refresh blocked; skipped frames are
+// coalesced since the next drawn frame always shows the latest display state
+#define SKIP_MAX       30        // draw at least every 31st frame (~2 fps)
+#define SKIP_QUEUE_MAX 512       // bytes still queued for the terminal
+#define SKIP_WRITE_NS  4000000   // refresh slower than this counts as blocked
+
+static int skip_interval = 0;    // frames skipped between drawn frames
+static int skip_pending = 0;     // frames left to skip before the next draw
+static int since_drawn = 0;      // frames skipped since the last drawn frame
+static long skipped_frames = 0;
+
+// keypad - terminals only report key presses (repeating while held), so a key
+// stays down for KEY_HOLD frames after its last press
+//   1 2 3 4      1 2 3 C
+//   q w e r  ->  4 5 6 D
+//   a s d f      7 8 9 E
+//   z x c v      A 0 B F
+#define KEY_HOLD 8
+
+static const char keymap[16] = {
+    'x', '1', '2', '3', 'q', 'w', 'e', 'a',
+    's', 'd', 'z', 'c', '4', 'r', 'f', 'v'
+};
+static int key_hold[16];
+
+static bool output_backlogged();
+static void present();
+
 // initialize ncurses for display
 void term_disp_init() {
     setlocale(LC_ALL, "en_US.UTF-8");
@@ -20,8 +66,33 @@ void term_disp_end() {
     endwin();
 }
 
+// temporarily hand the terminal back (debugger prompt on stdin)
+void term_disp_suspend() {
+    def_prog_mode();
+    endwin();
+}
+
+// restore ncurses display after term_disp_suspend
+void term_disp_resume() {
+    reset_prog_mode();
+    clear();
+    refresh();
+}
+
 // print display
 void term_disp_print(Chip8 *emu, int *prev_y, int *prev_x) {
+    // skip frames while the terminal can't keep up
+    // the queue is only checked here, by now it should have drained the last frame
+    if (since_drawn < SKIP_MAX && (skip_pending > 0 || output_backlogged())) {
+        if (skip_pending > 0) {
+            skip_pending--;
+        }
+        since_drawn++;
+        skipped_frames++;
+        return;
+    }
+    since_drawn = 0;
+
     int curr_y = getmaxy(stdscr);
     int curr_x = getmaxx(stdscr);
 
@@ -39,6 +110,14 @@ void term_disp_print(Chip8 *emu, int *prev_y, int *prev_x) {
     else if (curr_y > 16 && curr_x > 64) {
         print_display_half(emu);
     }
+    else if (curr_y > 8 && curr_x > 32) {
+        // status line has to fit in 32 columns too
+        print_display_braille(emu);
+        printw("%lc S:%-3d D:%-3d Skip:%-5ld", emu->sound_timer > 0 ? L'\u266A' : L' ',
+               (int)emu->sound_timer, (int)emu->delay_timer, skipped_frames);
+        present();
+        return;
+    }
     else {
         clear();
         printw("Terminal window size is too small.");
@@ -47,9 +126,63 @@ void term_disp_print(Chip8 *emu, int *prev_y, int *prev_x) {
     }
     printw("Beep: %ls        ", emu->sound_timer > 0 ? L"\u2588\u2588\u2588\u2588" : L"----");
     printw("Sound Timer: %d        ", emu->sound_timer);
-    printw("Delay Timer: %d", emu->delay_timer);
+    printw("Delay Timer: %d        ", emu->delay_timer);
+    printw("Skipped: %ld", skipped_frames);
     //printw("y: %d - x: %d", curr_y, curr_x);
+    present();
+}
+
+// read pending key presses, update the emulator's keypad (once per 60hz cycle)
+void term_disp_keys(Chip8 *emu) {
+    int ch;
+    while ((ch = getch()) != ERR) {
+        for (int i=0; i<16; i++) {
+            if (ch == keymap[i]) {
+                key_hold[i] = KEY_HOLD;
+            }
+        }
+    }
+
+    unsigned _BitInt(16) keys = 0;
+    for (int i=0; i<16; i++) {
+        if (key_hold[i] > 0) {
+            key_hold[i]--;
+            keys |= (unsigned _BitInt(16))1 << i;
+        }
+    }
+    emu->keys = keys;
+}
+
+// true if the terminal still has a backlog of output from earlier frames
+static bool output_backlogged() {
+    int queued = 0;
+    if (ioctl(STDOUT_FILENO, TIOCOUTQ, &queued) == -1) {
+        return false;
+    }
+    return queued > SKIP_QUEUE_MAX;
+}
+
+// refresh & adapt the skip interval to how long the write took
+// - blocked: double the interval
+// - clear:   step back down towards drawing every frame (60 fps)
+// the output queue isn't checked here, it still holds the frame just written
+static void present() {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     refresh();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long elapsed = (end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec);
+    if (elapsed > SKIP_WRITE_NS) {
+        skip_interval = skip_interval == 0 ? 1 : skip_interval * 2;
+        if (skip_interval > SKIP_MAX) {
+            skip_interval = SKIP_MAX;
+        }
+    }
+    else if (skip_interval > 0) {
+        skip_interval--;
+    }
+    skip_pending = skip_interval;
 }
 
 // print display (2 char-width per pixel - two full blocks)
@@ -99,5 +232,39 @@ void print_display_half(Chip8 *emu) {
         }
         printw("\n");
     }
-    refresh();
-}
\ No newline at end of file
+}
+
+// print display (8 pixels per char - 2x4 braille dots, 64x32 fits in 32x8)
+void print_display_braille(Chip8 *emu) {
+    print_braille(emu->display, 32, 1);
+}
+
+// print a 1-bit framebuffer as braille
+// rows   - framebuffer rows, each `words` 64-bit words wide (MSB is leftmost pixel)
+// height - number of pixel rows (multiple of 4)
+// words  - 64-bit words per row (1 for 64x32, 2 for 128x64), at most 4
+void print_braille(const unsigned _BitInt(64) *rows, int height, int words) {
+    wchar_t line[4 * 32 + 1];  // up to 256 pixels wide
+    if (words < 1 || words > 4) {
+        return;
+    }
+    int cols = words * 32;
+
+    for (int y=0; y<height; y+=4) {
+        const unsigned _BitInt(64) *r0 = rows + (y+0) * words;
+        const unsigned _BitInt(64) *r1 = rows + (y+1) * words;
+        const unsigned _BitInt(64) *r2 = rows + (y+2) * words;
+        const unsigned _BitInt(64) *r3 = rows + (y+3) * words;
+
+        for (int c=0; c<cols; c++) {
+            int w = c / 32;
+            int shift = 62 - (c % 32) * 2;
+            int top    = (int)((r0[w] >> shift) & 3) << 2 | (int)((r1[w] >> shift) & 3);
+            int bottom = (int)((r2[w] >> shift) & 3) << 2 | (int)((r3[w] >> shift) & 3);
+            line[c] = 0x2800 | braille_top[top] | braille_bottom[bottom];
+        }
+        line[cols] = L'\0';
+
+        printw("%ls\n", line);
+    }
+}
@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "init.h"
+#include "vec_env.h"
+
+// batched environments - step many instances one frame per call, writing every
+// display into one caller-owned buffer, no allocation after vec_env_new
+
+static void *worker_main(void*);
+static void step_shard(VecEnv*, int);
+
+////////////////////////////////////////////////////////////
+//                      Create / Free                     //
+////////////////////////////////////////////////////////////
+
+// create count instances of the rom in rom_fd
+// threads - number of shards stepped in parallel (1 - step on the calling thread only)
+VecEnv* vec_env_new(int rom_fd, int count, int threads) {
+    if (count < 1) {
+        return NULL;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > count) {
+        threads = count;
+    }
+
+    VecEnv *venv = (VecEnv*)calloc(1, sizeof(VecEnv));
+    Chip8 *emu = new_chip8(rom_fd);
+    snapshot_chip8(emu, &venv->initial);
+    free(emu);
+
+    venv->count = count;
+    venv->envs = (Chip8*)malloc(count * sizeof(Chip8));
+    for (int i=0; i<count; i++) {
+        snapshot_chip8(&venv->initial, &venv->envs[i]);
+    }
+    vec_env_seed(venv, venv->initial.rng_state);
+
+    venv->threads = threads;
+    if (threads > 1) {
+        pthread_barrier_init(&venv->start, NULL, threads);
+        pthread_barrier_init(&venv->done, NULL, threads);
+        venv->workers = (pthread_t*)malloc(threads * sizeof(pthread_t));
+        venv->shards = (VecShard*)malloc(threads * sizeof(VecShard));
+        for (int i=1; i<threads; i++) {
+            venv->shards[i].venv = venv;
+            venv->shards[i].index = i;
+            pthread_create(&venv->workers[i], NULL, worker_main, &venv->shards[i]);
+        }
+    }
+
+    return venv;
+}
+
+// stop workers & free all instances
+void vec_env_free(VecEnv *venv) {
+    if (venv->threads > 1) {
+        venv->stopping = true;
+        pthread_barrier_wait(&venv->start);
+        for (int i=1; i<venv->threads; i++) {
+            pthread_join(venv->workers[i], NULL);
+        }
+        pthread_barrier_destroy(&venv->start);
+        pthread_barrier_destroy(&venv->done);
+        free(venv->workers);
+        free(venv->shards);
+    }
+    free(venv->envs);
+    free(venv);
+}
+
+// give every instance its own random sequence derived from seed
+void vec_env_seed(VecEnv *venv, unsigned long seed) {
+    for (int i=0; i<venv->count; i++) {
+        // splitmix64
+        unsigned long z = seed + (i + 1) * 0x9E3779B97F4A7C15;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        z ^= z >> 31;
+        venv->envs[i].rng_state = (unsigned _BitInt(32))z | 1;
+    }
+}
+
+// back to power-on state, keeping the instance's random sequence
+// index - instance to reset, -1 for all
+void vec_env_reset(VecEnv *venv, int index) {
+    int first = index < 0 ? 0 : index;
+    int last = index < 0 ? venv->count - 1 : index;
+
+    for (int i=first; i<=last; i++) {
+        unsigned _BitInt(32) rng_state = venv->envs[i].rng_state;
+        snapshot_chip8(&venv->initial, &venv->envs[i]);
+        venv->envs[i].rng_state = rng_state;
+    }
+}
+
+
+////////////////////////////////////////////////////////////
+//                          Step                          //
+////////////////////////////////////////////////////////////
+
+// bytes per instance in the observation buffer
+size_t vec_env_obs_size(VecObs format) {
+    return format == OBS_PACKED ? 32 * 8 : 32 * 64;
+}
+
+// run one frame on every instance
+// keys - count keypad bitmaps
+// obs  - count * vec_env_obs_size(format) bytes
+// info - count counters, may be NULL
+void vec_env_step(VecEnv *venv, const unsigned _BitInt(16) *keys, unsigned char *obs,
+                  VecObs format, VecInfo *info) {
+    venv->keys = keys;
+    venv->obs = obs;
+    venv->format = format;
+    venv->info = info;
+
+    if (venv->threads > 1) {
+        pthread_barrier_wait(&venv->start);
+        step_shard(venv, 0);
+        pthread_barrier_wait(&venv->done);
+    }
+    else {
+        step_shard(venv, 0);
+    }
+}
+
+static void *worker_main(void *arg) {
+    VecEnv *venv = ((VecShard*)arg)->venv;
+    int shard = ((VecShard*)arg)->index;
+
+    for (;;) {
+        pthread_barrier_wait(&venv->start);
+        if (venv->stopping) {
+            return NULL;
+        }
+        step_shard(venv, shard);
+        pthread_barrier_wait(&venv->done);
+    }
+}
+
+// step instances [shard * count / threads, (shard + 1) * count / threads)
+static void step_shard(VecEnv *venv, int shard) {
+    int first = shard * venv->count / venv->threads;
+    int last = (shard + 1) * venv->count / venv->threads;
+    size_t obs_size = vec_env_obs_size(venv->format);
+
+    for (int i=first; i<last; i++) {
+        Chip8 *emu = &venv->envs[i];
+        unsigned _BitInt(64) before[32];
+        memcpy(before, emu->display, sizeof(before));
+        bool was_silent = emu->sound_timer == 0;
+
+        emu->keys = venv->keys[i];
+        run_frame(emu);
+
+        // observation
+        unsigned char *out = venv->obs + i * obs_size;
+        for (int row=0; row<32; row++) {
+            unsigned _BitInt(64) bits = emu->display[row];
+            if (venv->format == OBS_PACKED) {
+                for (int b=0; b<8; b++) {
+                    out[row * 8 + b] = (unsigned char)(bits >> (56 - b * 8));
+                }
+            }
+            else {
+                for (int col=0; col<64; col++) {
+                    out[row * 64 + col] = (bits >> (63 - col)) & 1;
+                }
+            }
+        }
+
+        // counters
+        if (venv->info != NULL) {
+            VecInfo *info = &venv->info[i];
+            info->frame_count = emu->frame_count;
+            info->pixels_changed = 0;
+            for (int row=0; row<32; row++) {
+                info->pixels_changed += __builtin_popcountll((unsigned long long)(before[row] ^ emu->display[row]));
+            }
+            info->sound_started = was_silent && emu->sound_timer > 0;
+            info->halted = emu->program_counter >= 0xFFF;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aot.h"
+#include "chip8.h"
+#include "cpu.h"
+#include "init.h"
+
+// aot_bench - run a rom headless through the interpreter and through the
+// chip8aot output, compare the per-frame display hash timelines & timing
+// usage: aot_bench /path/to/rom [frames]
+
+extern const AotProgram aot_program;
+
+double seconds_since(struct timespec*);
+
+int main(int argc, char ** argv) {
+    if (argc < 2) {
+        printf("Usage: aot_bench /path/to/rom [frames]\n");
+        return EXIT_FAILURE;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 60 * 60;
+
+    int rom = open(argv[1], O_RDONLY);
+    if (rom == -1) {
+        printf("ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+    Chip8 *interp = new_chip8(rom);
+    lseek(rom, 0, SEEK_SET);
+    Chip8 *compiled = new_chip8(rom);
+    close(rom);
+
+    // plain interpreter as the baseline, same random sequence for both runs
+    config_fusion(interp, false);
+    interp->rng_state = 1;
+    compiled->rng_state = 1;
+
+    static AotTable table;
+    aot_load(&aot_program, &table);
+
+    unsigned long long *timeline = malloc(frames * sizeof(unsigned long long));
+    Chip8 *run = (Chip8*)malloc(sizeof(Chip8));
+    struct timespec start;
+
+    // timed runs on copies, without hashing
+    snapshot_chip8(interp, run);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i=0; i<frames; i++) {
+        run_frame(run);
+    }
+    double interp_time = seconds_since(&start);
+
+    snapshot_chip8(compiled, run);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i=0; i<frames; i++) {
+        aot_run_frame(run, &table);
+    }
+    double aot_time = seconds_since(&start);
+
+    // compiled display timeline checked against the interpreter's
+    int mismatch = -1;
+    for (int i=0; i<frames; i++) {
+        run_frame(interp);
+        timeline[i] = display_hash(interp);
+    }
+    for (int i=0; i<frames; i++) {
+        aot_run_frame(compiled, &table);
+        if (mismatch == -1 && display_hash(compiled) != timeline[i]) {
+            mismatch = i;
+        }
+    }
+
+    printf("frames:      %d\n", frames);
+    printf("interpreter: %.3f ms (%.1f ns/frame)\n", interp_time * 1e3, interp_time * 1e9 / frames);
+    printf("aot:         %.3f ms (%.1f ns/frame)  %.2fx\n", aot_time * 1e3, aot_time * 1e9 / frames,
+           interp_time / aot_time);
+    printf("blocks:      %d, %lu compiled / %lu interpreted instructions (both passes)\n",
+           aot_program.block_count, table.compiled, table.interpreted);
+    if (mismatch == -1) {
+        printf("timeline:    identical\n");
+    } else {
+        printf("timeline:    DIFFERS from frame %d\n", mismatch);
+    }
+
+    free(timeline);
+    free(run);
+    free(interp);
+    free(compiled);
+    return mismatch == -1 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+double seconds_since(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "analyzer.h"
+#include "cfg.h"
+#include "cpu.h"
+
+// chip8analyze - disassemble a rom, flag quirk dependent opcodes & recommend a profile
+// usage: chip8analyze /path/to/rom
+// the result is (re)written to the analysis cache that config_quirk_analysis reads
+
+static const char *quirk_note(unsigned _BitInt(16));
+
+int main(int argc, char ** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: chip8analyze /path/to/rom\n");
+        return EXIT_FAILURE;
+    }
+
+    int rom = open(argv[1], O_RDONLY);
+    if (rom == -1) {
+        fprintf(stderr, "ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+
+    // load rom at 0x200, same as new_chip8
+    static unsigned _BitInt(8) memory[4096];
+    int rom_len = 0;
+    unsigned _BitInt(8) buffer;
+    while (0x200 + rom_len <= 0xFFF && read(rom, &buffer, 1) == 1) {
+        memory[0x200 + rom_len++] = buffer;
+    }
+    close(rom);
+
+    static Cfg cfg;
+    static Analysis an;
+    build_cfg(memory, rom_len, &cfg);
+    analyze_rom(memory, rom_len, &an);
+
+    printf("; %s - %d bytes, hash %016llx\n", argv[1], rom_len, an.rom_hash);
+
+    char text[32];
+    for (int r=0; r<an.region_count; r++) {
+        Region *region = &an.regions[r];
+        printf("\n; %s 0x%03X - 0x%03X\n", region->code ? "code" : "data", region->start, region->end);
+
+        if (!region->code) {
+            for (int addr=region->start; addr<=region->end; addr+=8) {
+                printf(" %03X: ", addr);
+                for (int i=addr; i<=region->end && i<addr+8; i++) {
+                    printf(" %02X", (int)memory[i]);
+                }
+                printf("\n");
+            }
+            continue;
+        }
+
+        for (int addr=region->start; addr<=region->end; addr++) {
+            if (!cfg.code[addr]) {
+                continue;
+            }
+            unsigned _BitInt(16) ins = memory[addr] * 0x100 + memory[addr + 1];
+            disassemble(ins, text, sizeof(text));
+            printf("%s%03X:  %04X  %-18s%s\n", cfg.leader[addr] ? "*" : " ", addr, (int)ins, text, quirk_note(ins));
+        }
+    }
+
+    printf("\n; quirk dependent opcodes (votes)\n");
+    printf(";   8XY6/8XYE X!=Y  %3d   VY %d / VX %d\n", an.shift_xy, an.shift_vy_votes, an.shift_vx_votes);
+    printf(";   BNNN            %3d   VX %d / V0 %d\n", an.jump_offset, an.jump_vx_votes, an.jump_v0_votes);
+    printf(";   FX55/FX65       %3d   inc %d / no inc %d\n", an.store_load, an.inc_votes, an.no_inc_votes);
+    printf("; recommended: shift_use_vy=%d jump_offset_vx=%d store_load_i_inc=%d\n",
+           an.shift_use_vy, an.jump_offset_vx, an.store_load_i_inc);
+
+    if (!analysis_cache_store(&an)) {
+        fprintf(stderr, "chip8analyze: couldn't write the analysis cache\n");
+    }
+    return EXIT_SUCCESS;
+}
+
+// marker for an opcode that behaves differently under a quirk
+static const char *quirk_note(unsigned _BitInt(16) ins) {
+    if (OP(ins) == 0x8 && (N(ins) == 0x6 || N(ins) == 0xE) && X(ins) != Y(ins)) {
+        return "; quirk: shift";
+    }
+    if (OP(ins) == 0xB && X(ins) != 0) {
+        return "; quirk: jump offset";
+    }
+    if (OP(ins) == 0xF && (NN(ins) == 0x55 || NN(ins) == 0x65)) {
+        return "; quirk: store/load";
+    }
+    return "";
+}
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cfg.h"
+#include "cpu.h"
+
+// chip8aot - compile a rom's statically reachable basic blocks to C
+// usage: chip8aot /path/to/rom > rom_aot.c
+// link the output with the emulator sources and run it with aot_run / aot_run_frame
+
+bool emit_instruction(FILE*, unsigned _BitInt(16));
+
+int main(int argc, char ** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: chip8aot /path/to/rom > rom_aot.c\n");
+        return EXIT_FAILURE;
+    }
+
+    int rom = open(argv[1], O_RDONLY);
+    if (rom == -1) {
+        fprintf(stderr, "ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+
+    // load rom at 0x200, same as new_chip8
+    static unsigned _BitInt(8) memory[4096];
+    int rom_len = 0;
+    unsigned _BitInt(8) buffer;
+    while (0x200 + rom_len <= 0xFFF && read(rom, &buffer, 1) == 1) {
+        memory[0x200 + rom_len++] = buffer;
+    }
+    close(rom);
+
+    static Cfg cfg;
+    build_cfg(memory, rom_len, &cfg);
+
+    printf("// generated by chip8aot from %s - do not edit\n\n", argv[1]);
+    printf("#include \"aot.h\"\n#include \"instructions.h\"\n\n");
+
+    // rom image, checked against memory before a block runs
+    printf("static const unsigned char image[%d] = {", rom_len);
+    for (int i=0; i<rom_len; i++) {
+        printf(i % 16 == 0 ? "\n    0x%02X," : " 0x%02X,", (int)memory[0x200 + i]);
+    }
+    printf("\n};\n\n");
+
+    // one function per basic block
+    // program counter is only stored before the last instruction, nothing
+    // before it in a block reads it
+    int starts[4096], lens[4096];
+    int block_count = 0;
+    for (int start=0x200; start<cfg.rom_end; start++) {
+        if (!cfg.leader[start] || !cfg.code[start] || cfg.written[start] || cfg.written[start + 1]) {
+            continue;
+        }
+
+        // extend until a control transfer, the next leader or a store target
+        int end = start;
+        while (!cfg.block_end[end]) {
+            int next = end + 2;
+            if (next + 1 >= cfg.rom_end || !cfg.code[next] || cfg.leader[next] || cfg.written[next] || cfg.written[next + 1]) {
+                break;
+            }
+            end = next;
+        }
+
+        printf("// 0x%03X - 0x%03X%s\n", start, end, cfg.dynamic[end] ? " (dynamic exit)" : "");
+        printf("static int block_%03X(Chip8 *emu) {\n", start);
+        for (int addr=start; addr<=end; addr+=2) {
+            unsigned _BitInt(16) ins = memory[addr] * 0x100 + memory[addr + 1];
+            if (addr == end) {
+                printf("    emu->program_counter = 0x%03X;\n", addr + 2);
+            }
+            printf("    ");
+            if (!emit_instruction(stdout, ins)) {
+                printf("// %04X : no-op", (int)ins);
+            }
+            printf("\n");
+        }
+        printf("    return %d;\n}\n\n", (end - start) / 2 + 1);
+
+        starts[block_count] = start;
+        lens[block_count] = (end - start) / 2 + 1;
+        block_count++;
+    }
+
+    printf("static const AotBlock blocks[%d] = {\n", block_count > 0 ? block_count : 1);
+    for (int i=0; i<block_count; i++) {
+        printf("    { 0x%03X, %d, block_%03X },\n", starts[i], lens[i], starts[i]);
+    }
+    printf("};\n\n");
+    printf("const AotProgram aot_program = { image, %d, blocks, %d };\n", rom_len, block_count);
+
+    fprintf(stderr, "chip8aot: %d blocks\n", block_count);
+    return EXIT_SUCCESS;
+}
+
+// print the handler call for an instruction, mirrors execute_instruction
+// return false if the instruction does nothing
+bool emit_instruction(FILE *out, unsigned _BitInt(16) ins) {
+    int x = X(ins), y = Y(ins), n = N(ins), nn = NN(ins), nnn = NNN(ins);
+
+    switch (OP(ins)) {
+    case 0x0:
+        switch (nnn) {
+        case 0x0E0: fprintf(out, "disp_clear(emu);"); return true;
+        case 0x0EE: fprintf(out, "subroutine_return(emu);"); return true;
+        }
+        return false;
+    case 0x1: fprintf(out, "jump(emu, 0x%03X);", nnn); return true;
+    case 0x2: fprintf(out, "subroutine_call(emu, 0x%03X);", nnn); return true;
+    case 0x3: fprintf(out, "skip_equal_const(emu, %d, 0x%02X);", x, nn); return true;
+    case 0x4: fprintf(out, "skip_not_equal_const(emu, %d, 0x%02X);", x, nn); return true;
+    case 0x5:
+        if (n != 0) {
+            return false;
+        }
+        fprintf(out, "skip_equal(emu, %d, %d);", x, y);
+        return true;
+    case 0x6: fprintf(out, "set_const(emu, %d, 0x%02X);", x, nn); return true;
+    case 0x7: fprintf(out, "add_const(emu, %d, 0x%02X);", x, nn); return true;
+    case 0x8:
+        switch (n) {
+        case 0x0: fprintf(out, "set(emu, %d, %d);", x, y); return true;
+        case 0x1: fprintf(out, "bitwise_or(emu, %d, %d);", x, y); return true;
+        case 0x2: fprintf(out, "bitwise_and(emu, %d, %d);", x, y); return true;
+        case 0x3: fprintf(out, "bitwise_xor(emu, %d, %d);", x, y); return true;
+        case 0x4: fprintf(out, "add(emu, %d, %d);", x, y); return true;
+        case 0x5: fprintf(out, "subtract_x_y(emu, %d, %d);", x, y); return true;
+        case 0x6: fprintf(out, "bitwise_shift_right(emu, %d, %d);", x, y); return true;
+        case 0x7: fprintf(out, "subtract_y_x(emu, %d, %d);", x, y); return true;
+        case 0xE: fprintf(out, "bitwise_shift_left(emu, %d, %d);", x, y); return true;
+        }
+        return false;
+    case 0x9:
+        if (n != 0) {
+            return false;
+        }
+        fprintf(out, "skip_not_equal(emu, %d, %d);", x, y);
+        return true;
+    case 0xA: fprintf(out, "set_index(emu, 0x%03X);", nnn); return true;
+    case 0xB: fprintf(out, "jump_offset(emu, 0x%03X);", nnn); return true;
+    case 0xC: fprintf(out, "gen_rand(emu, %d, 0x%02X);", x, nn); return true;
+    case 0xD: fprintf(out, "draw(emu, %d, %d, %d);", x, y, n); return true;
+    case 0xE:
+        switch (nn) {
+        case 0x9E: fprintf(out, "skip_key_pressed(emu, %d);", x); return true;
+        case 0xA1: fprintf(out, "skip_key_not_pressed(emu, %d);", x); return true;
+        }
+        return false;
+    case 0xF:
+        switch (nn) {
+        case 0x07: fprintf(out, "get_delay(emu, %d);", x); return true;
+        case 0x0A: fprintf(out, "await_key(emu, %d);", x); return true;
+        case 0x15: fprintf(out, "delay_timer(emu, %d);", x); return true;
+        case 0x18: fprintf(out, "sound_timer(emu, %d);", x); return true;
+        case 0x1E: fprintf(out, "add_index(emu, %d);", x); return true;
+        case 0x29: fprintf(out, "sprite_index(emu, %d);", x); return true;
+        case 0x33: fprintf(out, "bcd(emu, %d);", x); return true;
+        case 0x55: fprintf(out, "reg_dump(emu, %d);", x); return true;
+        case 0x65: fprintf(out, "reg_load(emu, %d);", x); return true;
+        }
+        return false;
+    }
+    return false;
+}
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "init.h"
+#include "state_hash.h"
+
+// chip8explore - breadth-first search over input sequences, deduplicating
+// identical machine states with the incremental state hash
+// each edge holds one key (or none) for a number of frames
+// usage: chip8explore [-d depth] [-f frames per step] [-w max frontier] [-v] /path/to/rom
+//        -v checks every state's incremental hash against a full recompute
+// a frontier bigger than -w stops the search with an error, it's never truncated
+
+// search tree node - states aren't kept, they're re-simulated from the root
+typedef struct Node {
+    unsigned long long hash;    // state hash, checked on re-simulation with -v
+    int parent;                 // -1 for the root
+    int input;                  // key held for the step, -1 for none
+} Node;
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// hold input (-1 for none) for a step of frames
+static void step(Chip8 *emu, int input, int frames) {
+    emu->keys = input < 0 ? 0 : (unsigned _BitInt(16))1 << input;
+    for (int f=0; f<frames && emu->program_counter < 0xFFF; f++) {
+        run_frame(emu);
+    }
+}
+
+int main(int argc, char ** argv) {
+    int depth = 8;
+    int frames = 4;
+    int max_frontier = 1 << 22;
+    bool verify = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:f:w:v")) != -1) {
+        switch (opt) {
+        case 'd': depth = atoi(optarg); break;
+        case 'f': frames = atoi(optarg); break;
+        case 'w': max_frontier = atoi(optarg); break;
+        case 'v': verify = true; break;
+        default:
+            printf("Usage: chip8explore [-d depth] [-f frames] [-w max_frontier] [-v] /path/to/rom\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 || depth < 1 || max_frontier < 1) {
+        printf("Usage: chip8explore [-d depth] [-f frames] [-w max_frontier] [-v] /path/to/rom\n");
+        return EXIT_FAILURE;
+    }
+
+    int rom = open(argv[optind], O_RDONLY);
+    if (rom == -1) {
+        printf("ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+    Chip8 *initial = new_chip8(rom);
+    close(rom);
+    initial->rng_state = 1;     // same tree every run
+    config_state_hash(initial, true);
+
+    // every level's nodes in one array, a level is [level_start, level_end)
+    size_t nodes_capacity = 1024;
+    Node *nodes = (Node*)malloc(nodes_capacity * sizeof(Node));
+    nodes[0] = (Node){ state_hash(initial), -1, -1 };
+    int level_start = 0, level_end = 1;
+
+    // states along the last re-simulated path, path_states[0] is the root
+    // consecutive parents share most of their path, only the rest is re-run
+    Chip8 *path_states = (Chip8*)malloc((depth + 1) * sizeof(Chip8));
+    int *path_nodes = (int*)malloc((depth + 1) * sizeof(int));
+    int *chain = (int*)malloc((depth + 1) * sizeof(int));
+    snapshot_chip8(initial, &path_states[0]);
+    path_nodes[0] = 0;
+    int path_depth = 0;
+
+    Chip8 *emu = (Chip8*)malloc(sizeof(Chip8));
+    StateSet *visited = state_set_new(1 << 20);
+    state_set_insert(visited, nodes[0].hash);
+
+    printf("%6s %10s %10s %10s %10s %12s %8s\n",
+           "depth", "frontier", "expanded", "new", "dupes", "visited", "sec");
+    double start = now_sec();
+    unsigned long mismatches = 0, total = 0, resimulated = 0;
+    bool truncated = false;
+
+    for (int d=1; d<=depth && level_end > level_start && !truncated; d++) {
+        int next_end = level_end;
+        unsigned long expanded = 0, fresh = 0, dupes = 0;
+
+        for (int p=level_start; p<level_end && !truncated; p++) {
+            // rebuild the parent's state, reusing the shared part of the last path
+            for (int n=p, k=d-1; k>0; n=nodes[n].parent, k--) {
+                chain[k] = n;
+            }
+            int k = 1;
+            while (k <= path_depth && k < d && path_nodes[k] == chain[k]) {
+                k++;
+            }
+            for (; k<d; k++) {
+                snapshot_chip8(&path_states[k-1], &path_states[k]);
+                step(&path_states[k], nodes[chain[k]].input, frames);
+                path_nodes[k] = chain[k];
+                resimulated++;
+                if (verify && state_hash(&path_states[k]) != nodes[chain[k]].hash) {
+                    mismatches++;
+                }
+            }
+            path_depth = d - 1;
+
+            // no key, then each key held for the whole step
+            for (int input=-1; input<16; input++) {
+                snapshot_chip8(&path_states[d-1], emu);
+                step(emu, input, frames);
+                expanded++;
+
+                unsigned long long hash = state_hash(emu);
+                if (verify && hash != state_hash_full(emu)) {
+                    mismatches++;
+                }
+                if (!state_set_insert(visited, hash)) {
+                    dupes++;
+                    continue;
+                }
+                if (next_end - level_end == max_frontier) {
+                    truncated = true;   // the search stops with an error
+                    break;
+                }
+                fresh++;
+                if ((size_t)next_end == nodes_capacity) {
+                    nodes_capacity *= 2;
+                    nodes = (Node*)realloc(nodes, nodes_capacity * sizeof(Node));
+                }
+                nodes[next_end++] = (Node){ hash, p, input };
+            }
+        }
+
+        total += expanded;
+        level_start = level_end;
+        level_end = next_end;
+
+        printf("%6d %10d %10lu %10lu %10lu %12zu %8.2f\n", d, level_end - level_start, expanded, fresh, dupes,
+               visited->count, now_sec() - start);
+        fflush(stdout);
+    }
+
+    double elapsed = now_sec() - start;
+    printf("\n%zu distinct states, %lu expanded (%.0f / s), %lu re-simulated steps\n", visited->count,
+           total, total / elapsed, resimulated);
+    printf("visited set %zu MB, search tree %zu MB\n", visited->capacity * sizeof(unsigned long long) >> 20,
+           nodes_capacity * sizeof(Node) >> 20);
+    if (verify) {
+        printf("hash check: %lu mismatches\n", mismatches);
+    }
+    if (truncated) {
+        printf("ERROR: frontier over %d states, search incomplete (raise -w)\n", max_frontier);
+    }
+
+    state_set_free(visited);
+    free(emu);
+    free(chain);
+    free(path_nodes);
+    free(path_states);
+    free(nodes);
+    free(initial);
+    return mismatches == 0 && !truncated ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "fuzzer.h"
+#include "init.h"
+
+// chip8fuzz - coverage guided fuzzing of a rom's inputs & rng, headless on every core
+// writes a reproducer per distinct fault: crash-<fault>-<pc>.txt
+// usage: chip8fuzz [-t seconds] [-j threads] [-S seed] /path/to/rom
+//        chip8fuzz -r crash.txt /path/to/rom     (replay a reproducer)
+
+int main(int argc, char ** argv) {
+    int seconds = 60;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int seed = (unsigned int)time(NULL);
+    char *replay = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:j:S:r:")) != -1) {
+        switch (opt) {
+        case 't': seconds = atoi(optarg); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'S': seed = strtoul(optarg, NULL, 0); break;
+        case 'r': replay = optarg; break;
+        default:
+            printf("Usage: chip8fuzz [-t seconds] [-j threads] [-S seed] [-r crash.txt] /path/to/rom\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1) {
+        printf("Usage: chip8fuzz [-t seconds] [-j threads] [-S seed] [-r crash.txt] /path/to/rom\n");
+        return EXIT_FAILURE;
+    }
+
+    int rom = open(argv[optind], O_RDONLY);
+    if (rom == -1) {
+        printf("ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+    Chip8 *initial = new_chip8(rom);
+    close(rom);
+
+    if (replay != NULL) {
+        FILE *file = fopen(replay, "r");
+        if (file == NULL) {
+            printf("ERROR: Can't open %s\n", replay);
+            return EXIT_FAILURE;
+        }
+        int pc = 0;
+        int fault = fuzzer_replay(initial, file, &pc);
+        fclose(file);
+        if (fault == FAULT_NONE) {
+            printf("no fault, stopped at 0x%03X after %lu frames\n", (int)initial->program_counter, initial->frame_count);
+        } else {
+            printf("%s at 0x%03X (frame %lu)\n", fault_name(fault), pc, initial->frame_count);
+        }
+        free(initial);
+        return fault == FAULT_NONE ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    printf("%d threads, seed 0x%08X, %d frames per execution\n", threads, seed, FUZZ_FRAMES);
+    printf("%6s %12s %10s %7s %7s %7s %8s %10s\n",
+           "sec", "execs", "execs/s", "corpus", "pcs", "edges", "crashes", "faults");
+
+    Fuzzer *fz = fuzzer_new(initial, threads, seed | 1);
+    unsigned long last = 0;
+    for (int s=1; s<=seconds; s++) {
+        sleep(1);
+        unsigned long execs = fuzzer_execs(fz);
+        printf("%6d %12lu %10lu %7d %7d %7d %8d %10lu\n", s, execs, execs - last,
+               atomic_load(&fz->corpus_count), atomic_load(&fz->pcs_covered), atomic_load(&fz->edges_covered),
+               atomic_load(&fz->crash_count), atomic_load(&fz->faults));
+        fflush(stdout);
+        last = execs;
+    }
+    fuzzer_stop(fz);
+
+    unsigned long execs = fuzzer_execs(fz);
+    printf("\n%lu executions (%.1fM / min)\n", execs, execs / (seconds / 60.0) / 1e6);
+
+    // one reproducer per distinct fault
+    for (int i=0; i<atomic_load(&fz->crash_count); i++) {
+        FuzzCrash *crash = &fz->crashes[i];
+        char path[64];
+        snprintf(path, sizeof(path), "crash-%s-%03X.txt", fault_name(crash->fault), crash->pc);
+        FILE *file = fopen(path, "w");
+        if (file == NULL) {
+            continue;
+        }
+        fuzzer_write_repro(fz, crash, file);
+        fclose(file);
+        printf("%-16s 0x%03X  %s\n", fault_name(crash->fault), crash->pc, path);
+    }
+
+    fuzzer_free(fz);
+    free(initial);
+    return EXIT_SUCCESS;
+}
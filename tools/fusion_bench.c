@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "init.h"
+
+// fusion_bench - macro-op fusion hit rates & speedup over a set of roms
+// each rom runs headless with fusion off and on, the architectural state
+// (registers, I, PC, stack, timers, memory & display) must match after every frame
+// usage: fusion_bench frames /path/to/rom...
+
+static const char *idiom_names[FUSE_COUNT] = {
+    "6XNN+FX15", "ANNN+DXYN", "7XNN chain", "delay wait", "FX33+FX65"
+};
+
+double time_frames(Chip8*, Chip8*, int);
+int    compare_frames(Chip8*, Chip8*, int);
+bool   same_state(Chip8*, Chip8*);
+
+int main(int argc, char ** argv) {
+    if (argc < 3) {
+        printf("Usage: fusion_bench frames /path/to/rom...\n");
+        return EXIT_FAILURE;
+    }
+    int frames = atoi(argv[1]);
+    int rtn = EXIT_SUCCESS;
+
+    printf("%-24s %9s %9s %8s %8s", "rom", "plain ms", "fused ms", "speedup", "hit %");
+    for (int k=0; k<FUSE_COUNT; k++) {
+        printf(" %11s", idiom_names[k]);
+    }
+    printf("  state\n");
+
+    for (int r=2; r<argc; r++) {
+        int rom = open(argv[r], O_RDONLY);
+        if (rom == -1) {
+            printf("%-24s can't open\n", argv[r]);
+            continue;
+        }
+        Chip8 *plain = new_chip8(rom);
+        lseek(rom, 0, SEEK_SET);
+        Chip8 *fused = new_chip8(rom);
+        close(rom);
+
+        config_fusion(fused, true);
+        plain->rng_state = 1;
+        fused->rng_state = 1;
+
+        // total instructions is the same either way, count it on a copy
+        Chip8 *run = (Chip8*)malloc(sizeof(Chip8));
+        unsigned long total = 0;
+        snapshot_chip8(plain, run);
+        for (int i=0; i<frames; i++) {
+            total += frame_instructions(run);
+            tick_timers(run);
+        }
+
+        // timed runs, then check the state frame by frame separately
+        double plain_time = time_frames(plain, run, frames);
+        double fused_time = time_frames(fused, run, frames);
+        unsigned long fused_count[FUSE_COUNT];
+        for (int k=0; k<FUSE_COUNT; k++) {
+            fused_count[k] = run->fused[k];
+        }
+        unsigned long fused_retired = run->fused_retired;
+
+        int differs = compare_frames(plain, fused, frames);
+        free(run);
+
+        const char *name = strrchr(argv[r], '/') ? strrchr(argv[r], '/') + 1 : argv[r];
+        printf("%-24.24s %9.2f %9.2f %7.2fx %7.1f%%", name, plain_time * 1e3, fused_time * 1e3,
+               plain_time / fused_time, 100.0 * fused_retired / total);
+        for (int k=0; k<FUSE_COUNT; k++) {
+            printf(" %11lu", fused_count[k]);
+        }
+        if (differs < 0) {
+            printf("  identical\n");
+        } else {
+            printf("  DIFFERS at frame %d\n", differs);
+            rtn = EXIT_FAILURE;
+        }
+
+        free(plain);
+        free(fused);
+    }
+
+    return rtn;
+}
+
+// run frames headless on a copy of initial (left in run)
+// return seconds taken
+double time_frames(Chip8 *initial, Chip8 *run, int frames) {
+    struct timespec start, end;
+
+    snapshot_chip8(initial, run);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i=0; i<frames; i++) {
+        run_frame(run);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// run both frames in lockstep, comparing the state after every frame
+// return the first frame that differs, -1 if none
+int compare_frames(Chip8 *plain, Chip8 *fused, int frames) {
+    for (int i=0; i<frames; i++) {
+        run_frame(plain);
+        run_frame(fused);
+        if (!same_state(plain, fused)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// architectural state, everything but configuration, keypad & stats
+bool same_state(Chip8 *a, Chip8 *b) {
+    return memcmp(a->display, b->display, sizeof(a->display)) == 0
+        && memcmp(a->memory, b->memory, sizeof(a->memory)) == 0
+        && memcmp(a->var_regs, b->var_regs, sizeof(a->var_regs)) == 0
+        && memcmp(a->stack, b->stack, sizeof(a->stack)) == 0
+        && a->program_counter == b->program_counter
+        && a->index_register == b->index_register
+        && a->stack_top == b->stack_top
+        && a->delay_timer == b->delay_timer
+        && a->sound_timer == b->sound_timer
+        && a->rng_state == b->rng_state
+        && a->frame_count == b->frame_count;
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "init.h"
+#include "scheduler.h"
+
+// sched_bench - how many real-time instances can a scheduler worker sustain
+// runs 1, 2, 4, ... instances per worker for a few seconds each until the
+// scheduler falls behind (dropped frames) or p99 lateness goes over the bound
+// usage: sched_bench /path/to/rom [workers] [seconds] [p99 bound ms]
+
+int main(int argc, char ** argv) {
+    if (argc < 2) {
+        printf("Usage: sched_bench /path/to/rom [workers] [seconds] [p99_ms]\n");
+        return EXIT_FAILURE;
+    }
+    int workers = argc > 2 ? atoi(argv[2]) : 1;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    double bound_ms = argc > 4 ? atof(argv[4]) : 2.0;
+
+    int rom = open(argv[1], O_RDONLY);
+    if (rom == -1) {
+        printf("ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+    Chip8 *initial = new_chip8(rom);
+    close(rom);
+
+    printf("%10s %12s %10s %10s %10s %10s\n",
+           "instances", "frames/s", "dropped", "p50 us", "p99 us", "max us");
+
+    for (int per_worker=1; per_worker<=1<<20; per_worker*=2) {
+        int count = per_worker * workers;
+        Chip8 *emus = (Chip8*)malloc(count * sizeof(Chip8));
+        Scheduler *sched = scheduler_new(workers);
+        for (int i=0; i<count; i++) {
+            snapshot_chip8(initial, &emus[i]);
+            scheduler_add(sched, &emus[i]);
+        }
+
+        sleep(seconds);
+        scheduler_stop(sched);
+
+        // merge worker stats
+        unsigned long frames = 0, dropped = 0, late[LATE_BUCKETS] = {0};
+        for (int i=0; i<workers; i++) {
+            frames += sched->workers[i].frames;
+            dropped += sched->workers[i].dropped;
+            for (int b=0; b<LATE_BUCKETS; b++) {
+                late[b] += sched->workers[i].late[b];
+            }
+        }
+        int p50 = -1, p99 = -1, max = 0;
+        unsigned long seen = 0;
+        for (int b=0; b<LATE_BUCKETS; b++) {
+            seen += late[b];
+            if (p50 == -1 && seen * 2 >= frames) p50 = b;
+            if (p99 == -1 && seen * 100 >= frames * 99) p99 = b;
+            if (late[b] > 0) max = b;
+        }
+
+        printf("%10d %12.0f %10lu %10d %10d %10d%s\n", count, (double)frames / seconds, dropped,
+               p50 * LATE_BUCKET_NS / 1000, p99 * LATE_BUCKET_NS / 1000, max * LATE_BUCKET_NS / 1000,
+               max == LATE_BUCKETS - 1 ? "+" : "");
+
+        scheduler_free(sched);
+        free(emus);
+
+        if (dropped > 0 || p99 * LATE_BUCKET_NS > bound_ms * 1000000) {
+            break;
+        }
+    }
+
+    free(initial);
+    return EXIT_SUCCESS;
+}
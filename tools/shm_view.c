@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <ncurses.h>
+
+#include "chip8.h"
+#include "shm_export.h"
+#include "term_disp.h"
+
+// shm_view - watch an emulator started with `chip8emu -s name`
+// usage: shm_view name     (q to quit)
+
+int main(int argc, char ** argv) {
+    if (argc != 2) {
+        printf("Usage: shm_view name\n");
+        return EXIT_FAILURE;
+    }
+
+    ShmFrame *frame = shm_view_open(argv[1]);
+    if (frame == NULL) {
+        printf("ERROR: No emulator exporting as %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    Chip8 *emu = (Chip8*)calloc(1, sizeof(Chip8));
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    int disp_x, disp_y;
+
+    term_disp_init();
+    while (getch() != 'q') {
+        shm_view_read(frame, emu);
+        term_disp_print(emu, &disp_y, &disp_x);
+
+        next.tv_nsec += 1000000000 / 60;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    term_disp_end();
+
+    shm_view_close(frame);
+    free(emu);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "chip8.h"
+#include "cpu.h"
+#include "init.h"
+#include "term_disp.h"
+
+// term_bench - bytes ncurses actually writes per frame for each display mode
+// each mode gets its own screen writing into a temporary file, the rom runs
+// headless and every frame is drawn & refreshed like term_disp_print does
+// usage: term_bench frames /path/to/rom
+
+static const char *mode_names[3] = { "full", "half", "braille" };
+
+static long file_size(FILE *file) {
+    struct stat st;
+    fflush(file);
+    fstat(fileno(file), &st);
+    return (long)st.st_size;
+}
+
+int main(int argc, char ** argv) {
+    if (argc != 3) {
+        printf("Usage: term_bench frames /path/to/rom\n");
+        return EXIT_FAILURE;
+    }
+    int frames = atoi(argv[1]);
+
+    int rom = open(argv[2], O_RDONLY);
+    if (rom == -1) {
+        printf("ERROR: Incorrect file path\n");
+        return EXIT_FAILURE;
+    }
+    Chip8 *initial = new_chip8(rom);
+    close(rom);
+    initial->rng_state = 1;     // same frames for every mode
+
+    // big enough for full mode, all modes draw into the same size screen
+    if (setlocale(LC_ALL, "en_US.UTF-8") == NULL) {
+        setlocale(LC_ALL, "C.UTF-8");
+    }
+    setenv("LINES", "40", 1);
+    setenv("COLUMNS", "140", 1);
+    setenv("TERM", getenv("TERM") != NULL ? getenv("TERM") : "xterm-256color", 0);
+
+    long first[3], total[3], max[3];
+    Chip8 *emu = (Chip8*)malloc(sizeof(Chip8));
+    FILE *in = fopen("/dev/null", "r");
+
+    for (int mode=0; mode<3; mode++) {
+        FILE *out = tmpfile();
+        SCREEN *screen = newterm(NULL, out, in);
+        if (screen == NULL) {
+            printf("ERROR: Can't open a screen for TERM=%s\n", getenv("TERM"));
+            return EXIT_FAILURE;
+        }
+        set_term(screen);
+        curs_set(0);
+
+        snapshot_chip8(initial, emu);
+        long before = file_size(out);
+        total[mode] = 0;
+        max[mode] = 0;
+        for (int f=0; f<frames; f++) {
+            run_frame(emu);
+
+            move(0, 0);
+            switch (mode) {
+            case 0: print_display_full(emu); break;
+            case 1: print_display_half(emu); break;
+            case 2: print_display_braille(emu); break;
+            }
+            refresh();
+
+            long written = file_size(out) - before;
+            before += written;
+            if (f == 0) {
+                first[mode] = written;  // full paint of an empty screen
+            } else {
+                total[mode] += written;
+                if (written > max[mode]) {
+                    max[mode] = written;
+                }
+            }
+        }
+
+        endwin();
+        delscreen(screen);
+        fclose(out);
+    }
+
+    printf("%-8s %12s %14s %12s\n", "mode", "first frame", "avg per frame", "max frame");
+    for (int mode=0; mode<3; mode++) {
+        printf("%-8s %12ld %14.1f %12ld\n", mode_names[mode], first[mode],
+               frames > 1 ? (double)total[mode] / (frames - 1) : 0.0, max[mode]);
+    }
+
+    fclose(in);
+    free(emu);
+    free(initial);
+    return EXIT_SUCCESS;
+}